@@ -2,4 +2,5 @@ TEMPLATE = subdirs
 CONFIG  += ordered
 
 SUBDIRS += $$PWD/src/src.pro
+unix: SUBDIRS += $$PWD/tools/tools.pro
 SUBDIRS += $$PWD/test/test.pro
@@ -0,0 +1,167 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamebatchrunner.h"
+#include "gameengine.h"
+#include "gamematerial.h"
+#include "gametracer.h"
+#include "utils.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtConcurrent/QtConcurrent>
+
+/*! \class GameBatchRunner
+ *  \brief The class GameBatchRunner steps many independent worlds
+ *  concurrently, e.g. for parameter studies.
+ *
+ * Each world has its own GameEngine, stepped from start to end
+ * by a single task of the global thread pool.
+ * The tasks are distributed dynamically: an idle thread takes the next worlds,
+ * so that all the cores stay busy even if some worlds are slower.
+ *
+ * The world \a index is seeded with \a seed + index, and the random
+ * generator is per thread: a world gives the same result in any batch.
+ *
+ * \sa GameEngine::step()
+ */
+
+/*
+ * Step a whole world. Called on a worker thread.
+ */
+static GameBatchRunner::Result runWorld(const GameBatchRunner::World &world)
+{
+    TRACE_SCOPE("GameBatchRunner::runWorld");
+
+    seedRandom(world.seed);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    GameEngine engine;
+    engine.setRunning(false);
+    engine.setSize(world.width, world.height);
+    engine.setFountainsEnabled(!world.random);
+    engine.setHashedColorsEnabled(world.hashedColors);
+    if (world.random) {
+        engine.fillRandomly();
+    }
+    for (int i = 0; i < world.steps; ++i) {
+        engine.step();
+    }
+
+    GameBatchRunner::Result result;
+    result.index = world.index;
+    result.seed = world.seed;
+    result.random = world.random;
+    result.nsecs = timer.nsecsElapsed();
+    result.population.resize(materialCount());
+    for (int i = 0; i < materialCount(); ++i) {
+        result.population[i] = engine.population((Material)i);
+    }
+    return result;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameBatchRunner::GameBatchRunner(const int worldCount, const int width, const int height,
+                                 const int steps, const uint seed)
+  : m_worldCount(worldCount)
+  , m_width(width)
+  , m_height(height)
+  , m_steps(steps)
+  , m_seed(seed)
+  , m_random(false)
+  , m_mixed(false)
+  , m_hashedColors(false)
+  , m_elapsed(0)
+{
+}
+
+/*!
+ * \brief Fill the worlds randomly, instead of the fountains.
+ */
+void GameBatchRunner::setRandomFill(const bool random)
+{
+    m_random = random;
+}
+
+/*!
+ * \brief Alternate the layouts: the odd worlds are filled randomly,
+ * the even worlds have the fountains.
+ */
+void GameBatchRunner::setMixedLayouts(const bool mixed)
+{
+    m_mixed = mixed;
+}
+
+/*!
+ * \brief Derive the color variation of the written dots from their position.
+ *
+ * \sa GameEngine::setHashedColorsEnabled()
+ */
+void GameBatchRunner::setHashedColors(const bool hashed)
+{
+    m_hashedColors = hashed;
+}
+
+/*!
+ * \brief Run all the worlds, and wait for them.
+ */
+void GameBatchRunner::run()
+{
+    QVector<World> worlds(m_worldCount);
+    for (int i = 0; i < m_worldCount; ++i) {
+        worlds[i] = World{i, m_seed + i, m_mixed ? (i % 2 == 1) : m_random,
+                          m_hashedColors, m_width, m_height, m_steps};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    m_results = QtConcurrent::blockingMapped<QList<Result> >(worlds, runWorld);
+    m_elapsed = timer.elapsed();
+}
+
+QList<GameBatchRunner::Result> GameBatchRunner::results() const
+{
+    return m_results;
+}
+
+/*!
+ * \brief Return the duration of run(), in milliseconds.
+ */
+qint64 GameBatchRunner::elapsed() const
+{
+    return m_elapsed;
+}
+
+/*!
+ * \brief Return the aggregate number of world steps per second.
+ */
+double GameBatchRunner::stepsPerSecond() const
+{
+    if (m_elapsed <= 0) {
+        return 0;
+    }
+    return 1000.0 * m_worldCount * m_steps / m_elapsed;
+}
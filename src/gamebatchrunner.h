@@ -0,0 +1,78 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_BATCH_RUNNER_H
+#define GAME_BATCH_RUNNER_H
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+class GameBatchRunner
+{
+public:
+    struct World {
+        int index;
+        uint seed;
+        bool random;        /* filled randomly, or empty with the fountains */
+        bool hashedColors;  /* see GameEngine::setHashedColorsEnabled() */
+        int width;
+        int height;
+        int steps;
+    };
+
+    struct Result {
+        int index;
+        uint seed;
+        bool random;
+        qint64 nsecs;               /* time spent stepping the world */
+        QVector<int> population;    /* final number of dots per material */
+    };
+
+    explicit GameBatchRunner(const int worldCount, const int width, const int height,
+                             const int steps, const uint seed);
+
+    void setRandomFill(const bool random);
+    void setMixedLayouts(const bool mixed);
+    void setHashedColors(const bool hashed);
+
+    void run();
+
+    QList<Result> results() const;
+    qint64 elapsed() const;
+    double stepsPerSecond() const;
+
+private:
+    int m_worldCount;
+    int m_width;
+    int m_height;
+    int m_steps;
+    uint m_seed;
+    bool m_random;
+    bool m_mixed;
+    bool m_hashedColors;
+    QList<Result> m_results;
+    qint64 m_elapsed;
+};
+
+#endif // GAME_BATCH_RUNNER_H
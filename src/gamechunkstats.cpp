@@ -0,0 +1,129 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamechunkstats.h"
+#include "gameworld.h"
+
+/*! \class GameChunkStats
+ *  \brief The class GameChunkStats measures the cost of each chunk of the world.
+ *
+ * For each chunk of GameWorld::chunkSize() dots, it counts the dots
+ * evaluated by a rule and the time spent in the chunk during the last step.
+ * It also marks the chunks modified during the step as awake,
+ * the other ones are sleeping.
+ *
+ * The engine switches to the next chunk every chunkSize() dots of a row,
+ * so the clock is read once per chunk and per row, not per dot.
+ *
+ * \sa GameEngine::setChunkStatsEnabled()
+ */
+
+GameChunkStats::GameChunkStats()
+  : m_columns(0)
+  , m_rows(0)
+  , m_current(-1)
+  , m_mark(0)
+{
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Reset the counters, for a world of the given \a width and \a height.
+ */
+void GameChunkStats::beginStep(const int width, const int height)
+{
+    const int size = GameWorld::chunkSize();
+    m_columns = (width + size - 1) / size;
+    m_rows = (height + size - 1) / size;
+    m_updates.fill(0, m_columns * m_rows);
+    m_nsecs.fill(0, m_columns * m_rows);
+    m_awake.fill(false, m_columns * m_rows);
+    m_current = -1;
+    m_timer.start();
+}
+
+/*!
+ * \brief Close the last chunk, and mark the chunks covered by \a dirtyRects as awake.
+ */
+void GameChunkStats::endStep(const QVector<QRect> &dirtyRects)
+{
+    if (m_current >= 0) {
+        m_nsecs[m_current] += m_timer.nsecsElapsed() - m_mark;
+        m_current = -1;
+    }
+    const int size = GameWorld::chunkSize();
+    foreach (const QRect &rect, dirtyRects) {
+        for (int j = rect.top() / size; j <= rect.bottom() / size && j < m_rows; ++j) {
+            for (int i = rect.left() / size; i <= rect.right() / size && i < m_columns; ++i) {
+                m_awake[j * m_columns + i] = true;
+            }
+        }
+    }
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+int GameChunkStats::columns() const
+{
+    return m_columns;
+}
+
+int GameChunkStats::rows() const
+{
+    return m_rows;
+}
+
+int GameChunkStats::updates(const int column, const int row) const
+{
+    return m_updates.at(row * m_columns + column);
+}
+
+qint64 GameChunkStats::nsecs(const int column, const int row) const
+{
+    return m_nsecs.at(row * m_columns + column);
+}
+
+bool GameChunkStats::isAwake(const int column, const int row) const
+{
+    return m_awake.at(row * m_columns + column);
+}
+
+int GameChunkStats::maxUpdates() const
+{
+    int max = 0;
+    foreach (const int value, m_updates) {
+        max = qMax(max, value);
+    }
+    return max;
+}
+
+qint64 GameChunkStats::maxNsecs() const
+{
+    qint64 max = 0;
+    foreach (const qint64 value, m_nsecs) {
+        max = qMax(max, value);
+    }
+    return max;
+}
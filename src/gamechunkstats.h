@@ -0,0 +1,81 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_CHUNK_STATS_H
+#define GAME_CHUNK_STATS_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+
+class GameChunkStats
+{
+public:
+    GameChunkStats();
+
+    void beginStep(const int width, const int height);
+    inline void beginChunk(const int x, const int y);
+    inline void countDot();
+    void endStep(const QVector<QRect> &dirtyRects);
+
+    int columns() const;
+    int rows() const;
+
+    int updates(const int column, const int row) const;
+    qint64 nsecs(const int column, const int row) const;
+    bool isAwake(const int column, const int row) const;
+
+    int maxUpdates() const;
+    qint64 maxNsecs() const;
+
+private:
+    int m_columns;
+    int m_rows;
+    QVector<int> m_updates;   /* dots evaluated by a rule */
+    QVector<qint64> m_nsecs;  /* time spent in the chunk */
+    QVector<bool> m_awake;    /* chunk modified */
+    int m_current;
+    qint64 m_mark;
+    QElapsedTimer m_timer;
+};
+
+/*!
+ * \brief Start to account the time and the dots to the chunk of the dot (x, y).
+ */
+inline void GameChunkStats::beginChunk(const int x, const int y)
+{
+    const qint64 now = m_timer.nsecsElapsed();
+    if (m_current >= 0) {
+        m_nsecs[m_current] += now - m_mark;
+    }
+    m_mark = now;
+    m_current = (y >> 4) * m_columns + (x >> 4); /* see GameWorld::chunkSize() */
+}
+
+inline void GameChunkStats::countDot()
+{
+    m_updates[m_current]++;
+}
+
+#endif // GAME_CHUNK_STATS_H
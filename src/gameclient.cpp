@@ -0,0 +1,267 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameclient.h"
+#include "gamedeltacodec.h"
+#include "gameengine.h"
+#include "gameprotocol.h"
+#include "gameworld.h"
+
+#include <QtCore/QDataStream>
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QTcpSocket>
+
+/*! \class GameClient
+ *  \brief The class GameClient shows the world of a GameServer
+ *  in a local GameEngine, its mirror.
+ *
+ * The mirror doesn't run: its world is only modified by the keyframes
+ * and the deltas received from the server.
+ * The GameWidget shows the mirror as usual.
+ *
+ * The mouse of the mirror is sent to the server as a brush.
+ * The solid dots are also painted locally, until the server confirms them.
+ *
+ * The world has the size of the server's world.
+ * If the mirror is resized, or a delta can't be applied,
+ * the client asks for a keyframe.
+ *
+ * The other actions on the world, such as Clear, Random or a new size,
+ * must be sent to the server with requestClear(), requestFillRandomly()
+ * and requestResize(): applied to the mirror only, they would be
+ * overwritten piece by piece by the deltas.
+ *
+ * \sa GameServer, GameDeltaCodec, GameProtocol
+ */
+
+GameClient::GameClient(GameEngine *mirror, QObject *parent) : QObject(parent)
+  , m_mirror(mirror)
+  , m_socket(Q_NULLPTR)
+  , m_width(0)
+  , m_height(0)
+  , m_isSynchronized(false)
+  , m_isPressed(false)
+  , m_tick(0)
+{
+    m_mirror->setRunning(false);
+    connect(m_mirror, SIGNAL(mouseChanged(bool,int,int)),
+            this, SLOT(onMouseChanged(bool,int,int)));
+    connect(m_mirror, SIGNAL(sizeChanged()), this, SLOT(onMirrorSizeChanged()));
+}
+
+GameClient::~GameClient()
+{
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Connect to the \a address, "host:port" or the name of a local socket.
+ *
+ * The errors are reported with qWarning().
+ *
+ * \sa GameProtocol
+ */
+void GameClient::connectToServer(const QString &address)
+{
+    delete m_socket;
+    m_buffer.clear();
+    m_isSynchronized = false;
+
+    QString host;
+    quint16 port;
+    if (GameProtocol::isTcpAddress(address, &host, &port)) {
+        QTcpSocket *socket = new QTcpSocket(this);
+        connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError()));
+        socket->connectToHost(host, port);
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_socket = socket;
+    } else {
+        QLocalSocket *socket = new QLocalSocket(this);
+        connect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(onError()));
+        socket->connectToServer(address);
+        m_socket = socket;
+    }
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+bool GameClient::isSynchronized() const
+{
+    return m_isSynchronized;
+}
+
+/*!
+ * \brief Return the server's tick of the last received world.
+ */
+quint64 GameClient::tick() const
+{
+    return m_tick;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameClient::onError()
+{
+    qWarning("Connection to the server: %s", qPrintable(m_socket->errorString()));
+    m_isSynchronized = false;
+}
+
+void GameClient::onReadyRead()
+{
+    m_buffer += m_socket->readAll();
+    readMessages();
+}
+
+void GameClient::readMessages()
+{
+    bool changed = false;
+    GameProtocol::MessageType type;
+    QByteArray payload;
+    GameProtocol::ReadStatus status;
+    while ((status = GameProtocol::readMessage(m_buffer, &type, &payload))
+           == GameProtocol::MessageRead) {
+        QDataStream in(payload);
+        switch (type) {
+        case GameProtocol::HelloMessage:
+        {
+            quint16 width;
+            quint16 height;
+            quint16 materials;
+            in >> width >> height >> materials;
+            if (materials != materialCount()) {
+                qWarning("The server has %d materials, but the client has %d.",
+                         materials, materialCount());
+            }
+            m_width = width;
+            m_height = height;
+            m_isSynchronized = false;
+            m_mirror->setSize(m_width, m_height);
+        }
+            break;
+        case GameProtocol::KeyframeMessage:
+        case GameProtocol::DeltaMessage:
+        {
+            /* The deltas apply to the last keyframe */
+            if (type == GameProtocol::DeltaMessage && !m_isSynchronized) {
+                break;
+            }
+            in >> m_tick;
+            const QByteArray cells = payload.mid(sizeof(quint64));
+            m_isSynchronized = GameDeltaCodec::decode(cells, m_mirror->world().data());
+            if (!m_isSynchronized) {
+                requestKeyframe();
+            }
+            changed = true;
+        }
+            break;
+        default:
+            break;
+        }
+    }
+    if (status == GameProtocol::MessageInvalid) {
+        qWarning("Connection to the server: invalid message");
+        m_buffer.clear();
+        m_socket->close();
+    }
+    /* Several messages received at once are shown at once */
+    if (changed) {
+        m_mirror->commitChanges();
+    }
+}
+
+void GameClient::requestKeyframe()
+{
+    if (m_socket) {
+        m_socket->write(GameProtocol::message(GameProtocol::KeyframeRequestMessage));
+    }
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Ask the server to clear the world.
+ */
+void GameClient::requestClear()
+{
+    if (m_socket) {
+        m_socket->write(GameProtocol::message(GameProtocol::ClearMessage));
+    }
+}
+
+/*!
+ * \brief Ask the server to fill the world randomly.
+ */
+void GameClient::requestFillRandomly()
+{
+    if (m_socket) {
+        m_socket->write(GameProtocol::message(GameProtocol::FillRandomlyMessage));
+    }
+}
+
+/*!
+ * \brief Ask the server to resize the world.
+ *
+ * The mirror is resized when the server confirms the new size.
+ */
+void GameClient::requestResize(const int width, const int height)
+{
+    if (!m_socket || (width == m_width && height == m_height)
+            || width <= 0 || height <= 0
+            || width > GameDeltaCodec::maxWorldSize() || height > GameDeltaCodec::maxWorldSize()) {
+        return;
+    }
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << (quint16)width << (quint16)height;
+    m_socket->write(GameProtocol::message(GameProtocol::ResizeMessage, payload));
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameClient::onMouseChanged(bool pressed, int x, int y)
+{
+    /* Only the strokes matter */
+    if (!m_socket || (!pressed && !m_isPressed)) {
+        return;
+    }
+    m_isPressed = pressed;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    /* The stroke may leave the world, which can be up to 65535 dots wide */
+    out << (quint8)pressed << (qint32)x << (qint32)y << (quint8)m_mirror->currentMaterial();
+    m_socket->write(GameProtocol::message(GameProtocol::BrushMessage, payload));
+}
+
+/*!
+ * \brief Keep the size of the server's world.
+ */
+void GameClient::onMirrorSizeChanged()
+{
+    if (m_width == 0 || (m_mirror->width() == m_width && m_mirror->height() == m_height)) {
+        return;
+    }
+    m_mirror->setSize(m_width, m_height);
+    m_isSynchronized = false;
+    requestKeyframe();
+}
@@ -0,0 +1,70 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_CLIENT_H
+#define GAME_CLIENT_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class QIODevice;
+class GameEngine;
+class GameClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GameClient(GameEngine *mirror, QObject *parent = 0);
+    ~GameClient();
+
+    void connectToServer(const QString &address);
+    bool isSynchronized() const;
+    quint64 tick() const;
+
+public Q_SLOTS:
+    void requestClear();
+    void requestFillRandomly();
+    void requestResize(const int width, const int height);
+
+private Q_SLOTS:
+    void onReadyRead();
+    void onError();
+    void onMouseChanged(bool pressed, int x, int y);
+    void onMirrorSizeChanged();
+
+private:
+    GameEngine *m_mirror;
+    QIODevice *m_socket;
+    QByteArray m_buffer;
+    int m_width;
+    int m_height;
+    bool m_isSynchronized;
+    bool m_isPressed;
+    quint64 m_tick;
+
+    void readMessages();
+    void requestKeyframe();
+};
+
+#endif // GAME_CLIENT_H
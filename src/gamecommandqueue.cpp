@@ -0,0 +1,127 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamecommandqueue.h"
+
+/*! \class GameCommandQueue
+ * \brief The class GameCommandQueue is a bounded lock-free queue of
+ * GameCommand, for one producer thread and one consumer thread.
+ *
+ * The producer only writes the head, and the consumer only writes the tail.
+ * A command is published by the release store of the head, after it's
+ * written in its slot, and its slot is given back by the release store of
+ * the tail, after it's read. Neither side ever waits for the other:
+ * push() fails when the queue is full, and pop() when it's empty.
+ *
+ * The capacity is rounded up to a power of two, so that the counters can
+ * wrap around and the slot is the counter masked.
+ *
+ * \sa GameEngine::post()
+ */
+
+GameCommandQueue::GameCommandQueue(const int capacity)
+    : m_mask(0)
+    , m_head(0)
+    , m_tail(0)
+{
+    int size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    m_commands.resize(size);
+    m_mask = (quint32)(size - 1);
+}
+
+int GameCommandQueue::capacity() const
+{
+    return m_commands.size();
+}
+
+/*!
+ * \brief Append the \a command, from the producer thread.
+ * Return false if the queue is full.
+ */
+bool GameCommandQueue::push(const GameCommand &command)
+{
+    const quint32 head = m_head.load();
+    if (head - m_tail.loadAcquire() > m_mask) {
+        return false;
+    }
+    m_commands[head & m_mask] = command;
+    m_head.storeRelease(head + 1);
+    return true;
+}
+
+/*!
+ * \brief Remove the oldest command into \a command, from the consumer thread.
+ * Return false if the queue is empty.
+ */
+bool GameCommandQueue::pop(GameCommand *command)
+{
+    const quint32 tail = m_tail.load();
+    if (tail == m_head.loadAcquire()) {
+        return false;
+    }
+    *command = m_commands.at(tail & m_mask);
+    m_tail.storeRelease(tail + 1);
+    return true;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameCommand GameCommand::mousePressed(const bool pressed)
+{
+    return GameCommand{MousePress, 0, pressed, 0, 0, Material::Air};
+}
+
+GameCommand GameCommand::mouseMoved(const int x, const int y)
+{
+    return GameCommand{MouseMove, 0, false, x, y, Material::Air};
+}
+
+GameCommand GameCommand::brush(const int id, const bool pressed, const int x, const int y,
+                               const Material material)
+{
+    return GameCommand{Brush, id, pressed, x, y, material};
+}
+
+GameCommand GameCommand::brushRemoved(const int id)
+{
+    return GameCommand{RemoveBrush, id, false, 0, 0, Material::Air};
+}
+
+GameCommand GameCommand::clear()
+{
+    return GameCommand{Clear, 0, false, 0, 0, Material::Air};
+}
+
+GameCommand GameCommand::fillRandomly()
+{
+    return GameCommand{FillRandomly, 0, false, 0, 0, Material::Air};
+}
+
+GameCommand GameCommand::resize(const int width, const int height)
+{
+    return GameCommand{Resize, 0, false, width, height, Material::Air};
+}
@@ -0,0 +1,79 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_COMMAND_QUEUE_H
+#define GAME_COMMAND_QUEUE_H
+
+#include "gamematerial.h"
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QVector>
+
+struct GameCommand
+{
+    enum Type {
+        MousePress,
+        MouseMove,
+        Brush,
+        RemoveBrush,
+        Clear,
+        FillRandomly,
+        Resize
+    };
+
+    Type type;
+    int id;
+    bool pressed;
+    int x;          /* or width */
+    int y;          /* or height */
+    Material material;
+
+    static GameCommand mousePressed(const bool pressed);
+    static GameCommand mouseMoved(const int x, const int y);
+    static GameCommand brush(const int id, const bool pressed, const int x, const int y,
+                             const Material material);
+    static GameCommand brushRemoved(const int id);
+    static GameCommand clear();
+    static GameCommand fillRandomly();
+    static GameCommand resize(const int width, const int height);
+};
+
+class GameCommandQueue
+{
+public:
+    explicit GameCommandQueue(const int capacity = 4096);
+
+    int capacity() const;
+
+    bool push(const GameCommand &command);
+    bool pop(GameCommand *command);
+
+private:
+    QVector<GameCommand> m_commands;
+    quint32 m_mask;
+    QAtomicInteger<quint32> m_head; /* next write, by the producer */
+    QAtomicInteger<quint32> m_tail; /* next read, by the consumer */
+};
+
+#endif // GAME_COMMAND_QUEUE_H
@@ -0,0 +1,195 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamedeltacodec.h"
+#include "gamematerial.h"
+#include "gametracer.h"
+#include "gameworld.h"
+
+#define C_MAX_RUN_LENGTH  255
+#define C_MAX_WORLD_SIZE  65535 // dots, on 16 bits
+#define C_MAX_RECT_COUNT  1024
+
+/*! \class GameDeltaCodec
+ *  \brief The class GameDeltaCodec encodes rectangles of the world's cells
+ *  with a run-length encoding.
+ *
+ * The encoded data is:
+ * \list
+ * \li the number of rectangles, on 16 bits,
+ * \li for each rectangle: x, y, width and height on 16 bits,
+ *     followed by the runs that cover its cells row by row.
+ *     A run is 2 bytes: its length (1 to 255) and the cell.
+ * \endlist
+ *
+ * Hence the width and height of the world are at most maxWorldSize().
+ * Past C_MAX_RECT_COUNT rectangles, e.g. after a big change of a large
+ * world, the rectangles are merged into their bounding rectangle.
+ *
+ * The integers are little-endian. A cell is the byte of GameWorld::constScanLine(),
+ * i.e. (2 * material + colorVariation).
+ *
+ * A delta only contains the dirty rectangles of a step:
+ * its size depends on what changed, not on the size of the world.
+ * A keyframe is a delta that contains the whole world.
+ *
+ * \sa GameServer, GameClient
+ */
+
+static inline void appendUInt16(QByteArray &data, const int value)
+{
+    data.append((char)(value & 0xFF));
+    data.append((char)((value >> 8) & 0xFF));
+}
+
+static inline int readUInt16(const uchar *&p)
+{
+    const int value = p[0] | (p[1] << 8);
+    p += 2;
+    return value;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the maximum width and height of an encoded world.
+ */
+int GameDeltaCodec::maxWorldSize()
+{
+    return C_MAX_WORLD_SIZE;
+}
+
+QByteArray GameDeltaCodec::encode(const GameWorld *world, const QVector<QRect> &rects)
+{
+    TRACE_SCOPE("GameDeltaCodec::encode");
+
+    Q_ASSERT(world->width() <= C_MAX_WORLD_SIZE && world->height() <= C_MAX_WORLD_SIZE);
+    const QRect bounds(0, 0, world->width(), world->height());
+    QVector<QRect> clipped;
+    clipped.reserve(qMin(rects.count(), C_MAX_RECT_COUNT + 1));
+    QRect united;
+    foreach (const QRect &rect, rects) {
+        const QRect r = rect & bounds;
+        if (!r.isEmpty()) {
+            clipped << r;
+            united |= r;
+        }
+    }
+    if (clipped.count() > C_MAX_RECT_COUNT) {
+        clipped.resize(1);
+        clipped[0] = united;
+    }
+
+    QByteArray data;
+    appendUInt16(data, clipped.count());
+    foreach (const QRect &r, clipped) {
+        appendUInt16(data, r.x());
+        appendUInt16(data, r.y());
+        appendUInt16(data, r.width());
+        appendUInt16(data, r.height());
+
+        /* The runs continue from one row to the next */
+        int length = 0;
+        uchar value = 0;
+        for (int y = r.top(); y <= r.bottom(); ++y) {
+            const uchar *cells = world->constScanLine(y);
+            for (int x = r.left(); x <= r.right(); ++x) {
+                if (length > 0 && (cells[x] != value || length == C_MAX_RUN_LENGTH)) {
+                    data.append((char)length);
+                    data.append((char)value);
+                    length = 0;
+                }
+                value = cells[x];
+                ++length;
+            }
+        }
+        data.append((char)length);
+        data.append((char)value);
+    }
+    return data;
+}
+
+QByteArray GameDeltaCodec::encodeKeyframe(const GameWorld *world)
+{
+    return encode(world, QVector<QRect>() << QRect(0, 0, world->width(), world->height()));
+}
+
+/*!
+ * \brief Write the cells of \a data into the \a world.
+ *
+ * The rectangles are moved by \a offset, e.g. when the world
+ * is a strip of the encoded one.
+ *
+ * The world keeps track of the modified dots, see GameWorld::takeDirtyRects().
+ * Return false if the data is invalid, or doesn't fit into the world.
+ */
+bool GameDeltaCodec::decode(const QByteArray &data, GameWorld *world, const QPoint &offset)
+{
+    TRACE_SCOPE("GameDeltaCodec::decode");
+
+    const uchar *p = (const uchar*)data.constData();
+    const uchar *end = p + data.size();
+    if (end - p < 2) {
+        return false;
+    }
+    const int materials = materialCount();
+    const int rectCount = readUInt16(p);
+    for (int i = 0; i < rectCount; ++i) {
+        if (end - p < 8) {
+            return false;
+        }
+        const int x0 = readUInt16(p) + offset.x();
+        const int y0 = readUInt16(p) + offset.y();
+        const int width = readUInt16(p);
+        const int height = readUInt16(p);
+        if (x0 < 0 || y0 < 0 || x0 + width > world->width() || y0 + height > world->height()) {
+            return false;
+        }
+        int x = x0;
+        int y = y0;
+        int remaining = width * height;
+        while (remaining > 0) {
+            if (end - p < 2) {
+                return false;
+            }
+            const int length = p[0];
+            const uchar cell = p[1];
+            p += 2;
+            if (length == 0 || length > remaining || (cell >> 1) >= materials) {
+                return false;
+            }
+            const Material material = (Material)(cell >> 1);
+            const ColorVariation color = (ColorVariation)(cell & 1);
+            for (int k = 0; k < length; ++k) {
+                world->setDot(x, y, material, color);
+                if (++x == x0 + width) {
+                    x = x0;
+                    ++y;
+                }
+            }
+            remaining -= length;
+        }
+    }
+    return p == end;
+}
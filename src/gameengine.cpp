@@ -23,7 +23,13 @@
  */
 
 #include "gameengine.h"
+#include "gameframepublisher.h"
+#include "gamerecorder.h"
 #include "gameworld.h"
+#include "gameworldgenerator.h"
+#include "gameworldlayout.h"
+#include "gamematerialrules.h"
+#include "gametracer.h"
 #include "utils.h"
 
 #include <QtCore/QDebug>
@@ -32,6 +38,8 @@
 #include <QtCore/QTimer>
 #include <QtCore/qmath.h>
 
+#include <climits>
+
 /*
  * Ideally:
  * The size of the world should be a multiple of 16.
@@ -45,10 +53,41 @@
 
 #define C_EXPLOSION_BLAST_WIDTH_IN_DOTS     3
 #define C_EXPLOSION_BLAST_HEIGHT_IN_DOTS   20
+#define C_FIRE_PLUME_HEIGHT_IN_DOTS        30
+
+/* Size of the default world of the window, stepped with a fixed layout */
+#define C_DEFAULT_WIDTH    160
+#define C_DEFAULT_HEIGHT   160
+
+/* Distance of the dots read by the rules, see stepRows() */
+#define C_STEP_MARGIN_X       3
+#define C_STEP_MARGIN_TOP     3
+#define C_STEP_MARGIN_BOTTOM  1
 
 #define C_INTERVAL_UPDATE_IN_MILLISECOND    30 // 30ms -> ~33Hz
 #define C_INTERVAL_FOUNTAIN_IN_MILLISECOND 100 // 100ms -> 10Hz
 
+/* With hashed colors, the color of a dot written at the same place changes every 2^N steps */
+#define C_HASHED_COLOR_TICK_SHIFT  4
+
+/* Beyond this number, the regions to record are merged into the whole world */
+#define C_MAX_RECORD_RECTS  1024
+
+/* Without any write nor input for this number of steps, the timers are paused */
+#define C_IDLE_STEPS  100 // ~3s
+
+/* When stepped manually, the fountains spawn at the same rate as with the timers */
+#define C_FOUNTAIN_EVERY_N_STEPS \
+    (C_INTERVAL_FOUNTAIN_IN_MILLISECOND / C_INTERVAL_UPDATE_IN_MILLISECOND)
+
+/*
+ * Macros for the rule-firing counters
+ */
+#define RULE_BEGIN(IDLE_RULE) \
+    do { if (m_ruleStatsEnabled) m_ruleStats.beginDot(IDLE_RULE); } while (0)
+#define RULE_HIT(RULE) \
+    do { if (m_ruleStatsEnabled) m_ruleStats.hit(RULE); } while (0)
+
 
 /*! \class GameEngine
  * \brief The class GameEngine contains the game scene and the game physics.
@@ -77,6 +116,16 @@ GameEngine::GameEngine(QObject *parent) : QObject(parent)
   , m_mousePosX(0)
   , m_mousePosY(0)
   , m_currentMaterial(Material::Water)
+  , m_commandsPending(0)
+  , m_ruleStatsEnabled(false)
+  , m_chunkStatsEnabled(false)
+  , m_tick(0)
+  , m_firstStepRow(0)
+  , m_lastStepRow(INT_MAX)
+  , m_fountainsEnabled(true)
+  , m_hashedColorsEnabled(false)
+  , m_isIdle(false)
+  , m_idleSteps(0)
 {
     /* initialize the game */
     resetFountains();
@@ -94,37 +143,38 @@ GameEngine::GameEngine(QObject *parent) : QObject(parent)
 
 GameEngine::~GameEngine()
 {
+    stopRecording();
 }
 
 void GameEngine::clear()
 {
+    wake();
     m_world->clear();
+    takeDirtyRects();
     emit changed();
 }
 
+/*!
+ * \brief Fill the world with a terrain, for a random seed.
+ * \sa generate()
+ */
 void GameEngine::fillRandomly()
 {
-    for (int y = m_world->height()-1; y >= 0; --y) {
-        for (int x = 0; x < m_world->width(); ++x) {
-
-            double r = myrandom();
-            Material mat;
-            if (r > 0.75) {
-                mat = Material::Earth;
-            } else if (r > 0.5) {
-                mat = Material::Rock;
-            } else if (r > 0.25) {
-                mat = Material::Water;
-            } else {
-                mat = Material::Fire;
-            }
-
-            m_world->setDot(x,y,mat);
-            ColorVariation c = computeRandomColor(mat);
-            m_world->setColorVariation(x,y,c);
-        }
-    }
+    GameTerrainGenerator generator;
+    generate(&generator, (uint)(myrandom() * UINT_MAX));
+}
 
+/*!
+ * \brief Fill the world with the dots of the \a generator, for the \a seed.
+ *
+ * A given seed always gives the same world.
+ * See GameWorld::generate() for the \a origin and the \a size.
+ */
+void GameEngine::generate(GameWorldGenerator *generator, const uint seed,
+                          const QPoint &origin, const QSize &size)
+{
+    wake();
+    m_world->generate(generator, seed, origin, size);
 }
 
 
@@ -163,11 +213,379 @@ void GameEngine::setSize(const int width, const int height)
 {
     if (width == m_world->width() && height == m_world->height())
         return;
+    wake();
     m_world->setSize(width, height);
     resetFountains();
     emit sizeChanged();
 }
 
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the number of dots of the given \a material.
+ *
+ * The counters are maintained by the world at each write.
+ * The signal populationChanged() is emitted once per step.
+ */
+int GameEngine::population(const Material material) const
+{
+    return m_world->population(material);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the regions of the world modified by the last change.
+ *
+ * The regions are in dots. They are collected just before
+ * the signal changed() is emitted, and are valid in its slots.
+ * They cover all the writes since the previous changed(),
+ * including the ones of the mouse and the bulk writes (clear, fill...).
+ */
+QVector<QRect> GameEngine::dirtyRects() const
+{
+    return m_dirtyRects;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isRuleStatsEnabled() const
+{
+    return m_ruleStatsEnabled;
+}
+
+/*!
+ * \brief Enable the counting of the rule branches fired by each step.
+ *
+ * When enabled, each step counts how many times each rule branch of
+ * updateGame() fires, and how many random values it draws.
+ * The counters are aggregated at the end of each step.
+ */
+void GameEngine::setRuleStatsEnabled(const bool enabled)
+{
+    if (enabled && !m_ruleStatsEnabled) {
+        m_ruleStats.clear();
+    }
+    m_ruleStatsEnabled = enabled;
+}
+
+/*!
+ * \brief Return the rule counters of the last step.
+ */
+GameRuleStats GameEngine::ruleStats() const
+{
+    return m_ruleStatsLastStep;
+}
+
+/*!
+ * \brief Return the rule counters aggregated since the last reset.
+ */
+GameRuleStats GameEngine::ruleStatsTotal() const
+{
+    return m_ruleStatsTotal;
+}
+
+void GameEngine::resetRuleStats()
+{
+    m_ruleStats.clear();
+    m_ruleStatsLastStep.clear();
+    m_ruleStatsTotal.clear();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isChunkStatsEnabled() const
+{
+    return m_chunkStatsEnabled;
+}
+
+/*!
+ * \brief Enable the measure of the cost of each chunk of the world.
+ *
+ * When disabled (default), the step only tests a flag once per dot.
+ *
+ * \sa GameChunkStats
+ */
+void GameEngine::setChunkStatsEnabled(const bool enabled)
+{
+    m_chunkStatsEnabled = enabled;
+}
+
+/*!
+ * \brief Return the cost of each chunk during the last step.
+ */
+GameChunkStats GameEngine::chunkStats() const
+{
+    return m_chunkStats;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isRunning() const
+{
+    return m_updateTimer->isActive() || m_isIdle;
+}
+
+/*!
+ * \brief Start or stop the timers that step the game.
+ *
+ * When stopped, the game only advances with step().
+ */
+void GameEngine::setRunning(const bool running)
+{
+    m_isIdle = false;
+    m_idleSteps = 0;
+    if (running) {
+        m_updateTimer->start();
+        m_fountainTimer->start();
+    } else {
+        m_updateTimer->stop();
+        m_fountainTimer->stop();
+        /* The commands posted while running waited for the next step */
+        processCommands();
+    }
+}
+
+/*!
+ * \brief Return true if the engine is running, but its timers are paused
+ * because the world is static.
+ *
+ * After C_IDLE_STEPS steps without any modified dot nor pressed mouse or
+ * brush, the steps would all be the same: the timers are stopped, and no
+ * frame is emitted anymore. Any input or modification of the world
+ * restarts them, see wake().
+ */
+bool GameEngine::isIdle() const
+{
+    return m_isIdle;
+}
+
+/*!
+ * \brief Restart the timers paused by the idle detection, if any.
+ *
+ * The input and the methods that modify the world call it already.
+ * It's meant for the observers that need a new frame, e.g. a GameServer
+ * with a new client.
+ */
+void GameEngine::wake()
+{
+    m_idleSteps = 0;
+    if (!m_isIdle) {
+        return;
+    }
+    m_isIdle = false;
+    m_updateTimer->start();
+    m_fountainTimer->start();
+}
+
+/*
+ * Collect the dots modified in the world, for the changed() signal,
+ * and for the next record.
+ */
+inline void GameEngine::takeDirtyRects()
+{
+    m_dirtyRects = m_world->takeDirtyRects();
+    if (m_recorder) {
+        m_recordRects += m_dirtyRects;
+        if (m_recordRects.count() > C_MAX_RECORD_RECTS) {
+            m_recordRects.clear();
+            m_recordRects << QRect(0, 0, m_world->width(), m_world->height());
+        }
+    }
+}
+
+inline bool GameEngine::isInputActive() const
+{
+    if (m_isMousePressed) {
+        return true;
+    }
+    foreach (const Brush &brush, m_brushes) {
+        if (brush.isPressed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Advance the game by one step, as fast as possible.
+ *
+ * The fountains spawn at the same rate, in steps, as with the timers.
+ * It's meant to be used when the engine isn't running,
+ * e.g. for the headless export.
+ */
+void GameEngine::step()
+{
+    updateGame();
+    if (m_tick % C_FOUNTAIN_EVERY_N_STEPS == 0) {
+        spawnFountain();
+    }
+}
+
+/*!
+ * \brief Return the number of steps done since the creation of the engine.
+ */
+quint64 GameEngine::tick() const
+{
+    return m_tick;
+}
+
+/*!
+ * \brief Return the largest number of rows between a dot and the dots
+ * that its step can write: the explosions, the fire plumes
+ * and the neighbours of the loaded rules.
+ */
+int GameEngine::maxReach()
+{
+    return qMax(qMax(C_EXPLOSION_BLAST_HEIGHT_IN_DOTS, C_FIRE_PLUME_HEIGHT_IN_DOTS),
+                GameMaterialRules::maxReach());
+}
+
+/*!
+ * \brief Evaluate only the dots of the rows \a first to \a last in the steps.
+ *
+ * The rules can still modify the dots of the other rows, e.g. the explosions.
+ * It's meant for a strip of a bigger world, see GameStrip.
+ * By default, all the rows are evaluated.
+ */
+void GameEngine::setStepRows(const int first, const int last)
+{
+    m_firstStepRow = qMax(0, first);
+    m_lastStepRow = last;
+}
+
+/*!
+ * \brief Return in \a source the dot of the step rows that moved into
+ * the dot (\a x, \a y), outside of the step rows, during the last step.
+ *
+ * Return false if the dot wasn't written by a move, e.g. by an explosion.
+ * It lets a GameStrip put the source back if the neighbour rejects the move.
+ */
+bool GameEngine::moveSource(const int x, const int y, QPoint *source) const
+{
+    QHash<int, QPoint>::const_iterator it = m_moveSources.constFind(y * m_world->width() + x);
+    if (it == m_moveSources.constEnd()) {
+        return false;
+    }
+    *source = it.value();
+    return true;
+}
+
+bool GameEngine::isFountainsEnabled() const
+{
+    return m_fountainsEnabled;
+}
+
+void GameEngine::setFountainsEnabled(const bool enabled)
+{
+    m_fountainsEnabled = enabled;
+    if (enabled) {
+        wake();
+    }
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isHashedColorsEnabled() const
+{
+    return m_hashedColorsEnabled;
+}
+
+/*!
+ * \brief Derive the color variation of the written dots from a hash of
+ * their position, material and tick, instead of a random value.
+ *
+ * It saves a random draw per written dot, including each dot of Air
+ * written by killDot() and moveDot().
+ */
+void GameEngine::setHashedColorsEnabled(const bool enabled)
+{
+    m_hashedColorsEnabled = enabled;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isPublishing() const
+{
+    return !m_publisher.isNull();
+}
+
+/*!
+ * \brief Publish each finished step into the shared memory \a name,
+ * a ring of \a slotCount frames, for other processes.
+ *
+ * The current world is published immediately, so that the errors
+ * are reported here.
+ * Return false if the shared memory can't be created.
+ *
+ * \sa GameFramePublisher
+ */
+bool GameEngine::startPublishing(const QString &name, const int slotCount,
+                                 QString *errorString)
+{
+    m_publisher.reset(new GameFramePublisher(name, slotCount));
+    if (!m_publisher->publish(m_world.data(), m_tick)) {
+        if (errorString) {
+            *errorString = m_publisher->errorString();
+        }
+        m_publisher.reset();
+        return false;
+    }
+    return true;
+}
+
+void GameEngine::stopPublishing()
+{
+    m_publisher.reset();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameEngine::isRecording() const
+{
+    return !m_recorder.isNull();
+}
+
+/*!
+ * \brief Record each finished step into the file \a fileName, with the
+ * whole world every \a keyframeInterval records, for GamePlayback.
+ *
+ * The current world is recorded immediately, as the first keyframe.
+ * Return false if the file can't be created.
+ *
+ * \sa GameRecorder
+ */
+bool GameEngine::startRecording(const QString &fileName, const int keyframeInterval,
+                                QString *errorString)
+{
+    m_recorder.reset(new GameRecorder(fileName, keyframeInterval));
+    m_recordRects.clear();
+    if (!m_recorder->open() || !m_recorder->record(m_world.data(), m_recordRects, m_tick)) {
+        if (errorString) {
+            *errorString = m_recorder->errorString();
+        }
+        m_recorder.reset();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief Record the last modifications, and close the recording.
+ */
+void GameEngine::stopRecording()
+{
+    if (!m_recorder) {
+        return;
+    }
+    if (!m_recorder->record(m_world.data(), m_recordRects, m_tick)
+            || !m_recorder->finish()) {
+        qWarning("%s", qPrintable(m_recorder->errorString()));
+    }
+    m_recorder.reset();
+    m_recordRects.clear();
+}
+
 /***********************************************************************************
  ***********************************************************************************/
 void GameEngine::resetFountains()
@@ -181,277 +599,613 @@ void GameEngine::resetFountains()
 
 }
 
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Queue the \a command, to be applied at the start of the next step.
+ *
+ * It's the way to modify the world from the input, e.g. the mouse events
+ * of a GameWidget: the input never waits for the step, nor modifies the
+ * world during it, and the commands received between two steps are
+ * applied at once. The commands must all be posted from the same thread.
+ *
+ * When the engine isn't running, the commands are applied from the event
+ * loop of the engine's thread instead. The commands still queued when
+ * the engine stops are applied by setRunning().
+ *
+ * Return false if the queue is full, and the command is lost.
+ *
+ * \sa processCommands()
+ */
+bool GameEngine::post(const GameCommand &command)
+{
+    if (!m_commands.push(command)) {
+        return false;
+    }
+    /* Not running, or idle */
+    if (!m_updateTimer->isActive() && m_commandsPending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "processCommands", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+/*!
+ * \brief Apply the commands queued by post(), in order.
+ *
+ * Unless a stroke is being painted, only the last of several mouse moves
+ * in a row is applied.
+ */
+void GameEngine::processCommands()
+{
+    TRACE_SCOPE("GameEngine::processCommands");
+
+    m_commandsPending.store(0);
+
+    GameCommand command;
+    GameCommand move;
+    bool hasMove = false;
+    while (m_commands.pop(&command)) {
+        if (command.type == GameCommand::MouseMove
+                && !(m_isMousePressed && isSolid(m_currentMaterial))) {
+            move = command;
+            hasMove = true;
+            continue;
+        }
+        if (hasMove) {
+            moveMouseTo(move.x, move.y);
+            hasMove = false;
+        }
+        switch (command.type) {
+        case GameCommand::MousePress:
+            setMousePressed(command.pressed);
+            break;
+        case GameCommand::MouseMove:
+            moveMouseTo(command.x, command.y);
+            break;
+        case GameCommand::Brush:
+            setBrush(command.id, command.pressed, command.x, command.y, command.material);
+            break;
+        case GameCommand::RemoveBrush:
+            removeBrush(command.id);
+            break;
+        case GameCommand::Clear:
+            clear();
+            break;
+        case GameCommand::FillRandomly:
+            fillRandomly();
+            break;
+        case GameCommand::Resize:
+            setSize(command.x, command.y);
+            break;
+        default:
+            break;
+        }
+    }
+    if (hasMove) {
+        moveMouseTo(move.x, move.y);
+    }
+}
+
 /***********************************************************************************
  ***********************************************************************************/
 void GameEngine::setMousePressed(const bool pressed)
 {
+    wake();
     m_isMousePressed = pressed;
     if (isSolid(m_currentMaterial)) {
         spawnMouse();
     }
+    emit mouseChanged(m_isMousePressed, m_mousePosX, m_mousePosY);
 }
 
 void GameEngine::moveMouseTo(const int posX, const int posY)
 {
+    wake();
     if (m_isMousePressed && isSolid(m_currentMaterial)) {
-        const double dx = posX - m_mousePosX;
-        const double dy = posY - m_mousePosY;
-        const double length = std::sqrt(std::pow(dx, 2) + std::pow(dy, 2));
-
-        for (int i = 0; i < qCeil(length); ++i) {
-            const double pc = (double)i/length;
-            const int xx = m_mousePosX + dx*pc;
-            const int yy = m_mousePosY + dy*pc;
-            spawnDot(xx, yy, m_currentMaterial);
-        }
+        spawnLine(m_mousePosX, m_mousePosY, posX, posY, m_currentMaterial);
     }
     m_mousePosX = posX;
     m_mousePosY = posY;
+    emit mouseChanged(m_isMousePressed, m_mousePosX, m_mousePosY);
 }
 
+/*!
+ * \brief Set the state of the brush \a id, painted like the mouse.
+ *
+ * The brushes are the mice of other users, e.g. the clients of a GameServer.
+ * The dots are collected with the next step.
+ *
+ * \sa removeBrush()
+ */
+void GameEngine::setBrush(const int id, const bool pressed, const int x, const int y,
+                          const Material material)
+{
+    wake();
+    const Brush previous = m_brushes.value(id, Brush{false, x, y, material});
+    if (pressed && isSolid(material)) {
+        if (previous.isPressed) {
+            spawnLine(previous.x, previous.y, x, y, material);
+        } else {
+            spawnDot(x, y, material);
+        }
+    }
+    m_brushes.insert(id, Brush{pressed, x, y, material});
+}
+
+void GameEngine::removeBrush(const int id)
+{
+    m_brushes.remove(id);
+}
+
+/*!
+ * \brief Notify the dots modified directly in the world().
+ *
+ * It's meant for a world that is modified outside of the steps,
+ * e.g. by a GameClient.
+ */
+void GameEngine::commitChanges()
+{
+    wake();
+    takeDirtyRects();
+    emit changed();
+    emit populationChanged();
+}
 
 /***********************************************************************************
  ***********************************************************************************/
-void GameEngine::updateGame()
+/*!
+ * \brief Apply the rules to the rows of the step, from the bottom.
+ *
+ * The Layout reads the cells, see gameworldlayout.h. It is a template
+ * parameter so that each layout gets its own inlined copy of the rules.
+ *
+ * The rules read the dots up to C_STEP_MARGIN_X dots aside, C_STEP_MARGIN_TOP
+ * dots above and C_STEP_MARGIN_BOTTOM dots below. The dots far enough from
+ * the edges of the world are read without bounds check: only the dots
+ * near the edges pay for it.
+ */
+template <class Layout>
+void GameEngine::stepRows(const Layout &layout)
 {
-    for (int y = m_world->height()-1; y >= 0; --y) {
-        for (int x = 0; x < m_world->width(); ++x) {
+    const bool chunkStats = m_chunkStatsEnabled;
+    const int chunkMask = GameWorld::chunkSize() - 1;
+    const GameInteriorLayout<Layout> interior(layout);
 
-            /// \todo if (m_worldLock[y * gameAreaSizeWidth + x]==true) continue;
+    const int lastRow = qMin(m_lastStepRow, layout.height()-1);
+    for (int y = lastRow; y >= m_firstStepRow; --y) {
+        const bool isInteriorRow = (y >= C_STEP_MARGIN_TOP
+                                    && y < layout.height() - C_STEP_MARGIN_BOTTOM);
+        const int x1 = isInteriorRow ? C_STEP_MARGIN_X : layout.width();
+        const int x2 = isInteriorRow ? layout.width() - C_STEP_MARGIN_X : layout.width();
+        for (int x = 0; x < layout.width(); ++x) {
+            if (chunkStats && (x & chunkMask) == 0) {
+                m_chunkStats.beginChunk(x, y);
+            }
+            if (x >= x1 && x < x2) {
+                stepDot(interior, x, y);
+            } else {
+                stepDot(layout, x, y);
+            }
+        }
+    }
+}
+
+template <class Layout>
+inline void GameEngine::stepDot(const Layout &layout, const int x, const int y)
+{
+    /// \todo if (m_worldLock[y * gameAreaSizeWidth + x]==true) return;
+
+    if ( y >= layout.height() ) {
+        killDot(x,y);
+    }
+
+    const Material d = layout.dot(x, y);
+    const Material dbc = layout.dot(x, y+1);
+    const Material dtc = layout.dot(x, y-1);
+
+    if (m_chunkStatsEnabled && d != Material::Earth && d != Material::Air && d != Material::Rock) {
+        m_chunkStats.countDot();
+    }
+
+    /* The rules of the definition file replace the built-in ones */
+    const MaterialRule *rule = GameMaterialRules::begin(d);
+    const MaterialRule *lastRule = GameMaterialRules::end(d);
+    if (rule != lastRule) {
+        applyRules(x, y, rule, lastRule);
+        return;
+    }
 
-            if ( y >= m_world->height() ) {
+    switch (d) {
+    case Material::Earth:
+    case Material::Air:
+    case Material::Rock:
+        return;
+
+    case Material::Acid:
+    {
+        RULE_BEGIN(Rule::AcidIdle);
+
+        if (dbc == Material::Air) {
+            RULE_HIT(Rule::AcidFall);
+            if (myrandom()<0.9)
+                moveDot(x,y,x,y+1,Material::Air, Material::Acid);
+        } else if (dbc == Material::Fire) {
+            RULE_HIT(Rule::AcidBurnFire);
+            moveDot(x,y,x,y+1,Material::Plasma, Material::Acid);
+        } else if (dbc == Material::Water) {
+            RULE_HIT(Rule::AcidSinkWater);
+            if (myrandom()<0.7)
+                moveDot(x,y,x,y+1,Material::Water, Material::Acid);
+        } else if (dbc == Material::Sand) {
+            RULE_HIT(Rule::AcidDissolveOnSand);
+            if (myrandom()<0.05)
                 killDot(x,y);
-            }
+        } else if (dbc == Material::Rock
+                   || layout.dot(x-1,y) == Material::Rock
+                   || layout.dot(x+1,y) == Material::Rock) {
+            RULE_HIT(Rule::AcidSpreadOnRock);
+            liquid(layout,x,y,Material::Acid);
+        } else if (dbc != Material::Air && dbc != Material::Acid && myrandom()<0.04) {
+            RULE_HIT(Rule::AcidEatBelow);
+            moveDot(x,y,x,y+1,Material::Air,Material::Acid);
+        } else if (myrandom()<0.05 && layout.dot(x+1,y) != Material::Acid) {
+            RULE_HIT(Rule::AcidMoveRight);
+            moveDot(x,y,x+1,y,Material::Air, Material::Acid);
+        } else if (myrandom()<0.05 && layout.dot(x-1,y) != Material::Acid) {
+            RULE_HIT(Rule::AcidMoveLeft);
+            moveDot(x,y,x-1,y,Material::Air, Material::Acid);
+        } else if (dbc == Material::Oil) {
+            RULE_HIT(Rule::AcidExplodeOil);
+            if (myrandom()<0.005)
+                boom(x,y,Material::Fire);
+        } else if (dbc != Material::Air)  {
+            RULE_HIT(Rule::AcidSpread);
+            liquid(layout,x,y,Material::Acid);
+        }
 
-            const Material d = m_world->dot(x, y);
-            const Material dbc = m_world->dot(x, y+1);
-            const Material dtc = m_world->dot(x, y-1);
+    }
+        break;
+    case Material::Fire:
+    {
+        RULE_BEGIN(Rule::FireIdle);
 
-            switch (d) {
-            case Material::Earth:
-            case Material::Air:
-            case Material::Rock:
-                continue;
-                break;
-
-            case Material::Acid:
-            {
-
-                if (dbc == Material::Air) {
-                    if (myrandom()<0.9)
-                        moveDot(x,y,x,y+1,Material::Air, Material::Acid);
-                } else if (dbc == Material::Fire) {
-                    moveDot(x,y,x,y+1,Material::Plasma, Material::Acid);
-                } else if (dbc == Material::Water) {
-                    if (myrandom()<0.7)
-                        moveDot(x,y,x,y+1,Material::Water, Material::Acid);
-                } else if (dbc == Material::Sand) {
-                    if (myrandom()<0.05)
-                        killDot(x,y);
-                } else if (dbc == Material::Rock
-                           || m_world->dot(x-1,y) == Material::Rock
-                           || m_world->dot(x+1,y) == Material::Rock) {
-                    liquid(x,y,Material::Acid);
-                } else if (dbc != Material::Air && dbc != Material::Acid && myrandom()<0.04) {
-                    moveDot(x,y,x,y+1,Material::Air,Material::Acid);
-                } else if (myrandom()<0.05 && m_world->dot(x+1,y) != Material::Acid) {
-                    moveDot(x,y,x+1,y,Material::Air, Material::Acid);
-                } else if (myrandom()<0.05 && m_world->dot(x-1,y) != Material::Acid) {
-                    moveDot(x,y,x-1,y,Material::Air, Material::Acid);
-                } else if (dbc == Material::Oil) {
-                    if (myrandom()<0.005)
-                        boom(x,y,Material::Fire);
-                } else if (dbc != Material::Air)  {
-                    liquid(x,y,Material::Acid);
-                }
+        if (dbc == Material::Air && myrandom()<0.7) {
+            RULE_HIT(Rule::FireFall);
+            moveDot(x,y,x,y+1,Material::Air,Material::Fire);
+        } else if (dtc == Material::Rock) {
+            RULE_HIT(Rule::FireDieUnderRock);
+            killDot(x,y);
+        } else if ((dbc == Material::Oil || dbc == Material::Acid) && myrandom()<0.5) {
+            RULE_HIT(Rule::FireSpreadRightOnFuel);
+            addDot(x+1,y-1,Material::Fire);
+        } else if ((dbc == Material::Oil || dbc == Material::Acid) && myrandom()<0.5) {
+            RULE_HIT(Rule::FireSpreadLeftOnFuel);
+            addDot(x-1,y-1,Material::Fire);
+        } else if (dbc == Material::Oil) {
+            RULE_HIT(Rule::FireBurnOil);
+            if (myrandom()<0.002)
+                killDot(x,y+1);
+            addDot(x,y-10-((C_FIRE_PLUME_HEIGHT_IN_DOTS-10)*myrandom()),Material::Fire);
+            addDot(x,y-1-(10*myrandom()),Material::Fire);
+        } else if (dbc == Material::Acid) {
+            RULE_HIT(Rule::FireExplodeAcid);
+            if (myrandom()<0.1)
+                boom(x,y+1,Material::Fire);
+        } else if (dbc == Material::Rock && myrandom()<0.03) {
+            RULE_HIT(Rule::FireDieOnRock);
+            killDot(x,y);
+        } else if ((dbc == Material::Air || dbc == Material::Earth) && myrandom()<0.02) {
+            RULE_HIT(Rule::FireSpreadRight);
+            addDot(x+1,y-1,Material::Fire);
+        } else if ((dbc == Material::Air || dbc == Material::Earth) && myrandom()<0.02) {
+            RULE_HIT(Rule::FireSpreadLeft);
+            addDot(x-1,y-1,Material::Fire);
+        } else if (dbc == Material::Earth && myrandom()<0.004) {
+            RULE_HIT(Rule::FireBurnEarth);
+            killDot(x,y+1);
+        } else if (dbc == Material::Fire && myrandom()<0.4) {
+            RULE_HIT(Rule::FireRise);
+            moveDot(x,y,x,y-2,Material::Air,Material::Fire);
+        } else if (dtc == Material::Fire
+                   && layout.dot(x,y-2) == Material::Fire
+                   && layout.dot(x,y-3) == Material::Fire) {
+            RULE_HIT(Rule::FireDieInPlume);
+            killDot(x,y);
+        }
+    }
+        break;
+    case Material::Oil:
+    {
+        RULE_BEGIN(Rule::OilIdle);
 
-            }
-                break;
-            case Material::Fire:
-            {
-                if (dbc == Material::Air && myrandom()<0.7) {
-                    moveDot(x,y,x,y+1,Material::Air,Material::Fire);
-                } else if (dtc == Material::Rock) {
-                    killDot(x,y);
-                } else if ((dbc == Material::Oil || dbc == Material::Acid) && myrandom()<0.5) {
-                    addDot(x+1,y-1,Material::Fire);
-                } else if ((dbc == Material::Oil || dbc == Material::Acid) && myrandom()<0.5) {
-                    addDot(x-1,y-1,Material::Fire);
-                } else if (dbc == Material::Oil) {
-                    if (myrandom()<0.002)
-                        killDot(x,y+1);
-                    addDot(x,y-10-(20*myrandom()),Material::Fire);
-                    addDot(x,y-1-(10*myrandom()),Material::Fire);
-                } else if (dbc == Material::Acid) {
-                    if (myrandom()<0.1)
-                        boom(x,y+1,Material::Fire);
-                } else if (dbc == Material::Rock && myrandom()<0.03) {
-                    killDot(x,y);
-                } else if ((dbc == Material::Air || dbc == Material::Earth) && myrandom()<0.02) {
-                    addDot(x+1,y-1,Material::Fire);
-                } else if ((dbc == Material::Air || dbc == Material::Earth) && myrandom()<0.02) {
-                    addDot(x-1,y-1,Material::Fire);
-                } else if (dbc == Material::Earth && myrandom()<0.004) {
-                    killDot(x,y+1);
-                } else if (dbc == Material::Fire && myrandom()<0.4) {
-                    moveDot(x,y,x,y-2,Material::Air,Material::Fire);
-                } else if (dtc == Material::Fire
-                           && m_world->dot(x,y-2) == Material::Fire
-                           && m_world->dot(x,y-3) == Material::Fire) {
-                    killDot(x,y);
-                }
-            }
-                break;
-            case Material::Oil:
-            {
-                if (dbc == Material::Fire && myrandom()<0.2) {
-                    moveDot(x,y,x,y+1,Material::Fire,Material::Oil);
-                } else if (dbc == Material::Air) {
-                    if (myrandom()<0.7)
-                        moveDot(x,y,x,y+1,Material::Air,Material::Oil);
-                } else if (dbc == Material::Fire && myrandom()<0.1) {
-                    addDot(x,y,Material::Fire);
-                } else if (dbc == Material::Air && myrandom()<0.05) {
-                    addDot(x,y+1,Material::Oil);
-                } else if (dbc != Material::Air) {
-                    liquid(x,y,Material::Oil);
-                }
-            }
-                break;
-            case Material::Plasma:
-            {
-                if (myrandom()<0.1)
-                    killDot(x,y);
-            }
-                break;
-            case Material::Sand:
-            {
-                if (dbc == Material::Air) {
-                    if (myrandom()<0.9)
-                        moveDot(x,y,x,y+1,Material::Air,Material::Sand);
-                } else if (dbc == Material::Water) {
-                    if (myrandom()<0.6)
-                        moveDot(x,y,x,y+1,Material::Water,Material::Sand);
-                } else if (dbc == Material::Acid) {
-                    if (myrandom()<0.1)
-                        moveDot(x,y,x,y+1,Material::Acid,Material::Sand);
-                } else if (dbc == Material::Oil) {
-                    if (myrandom()<0.3)
-                        moveDot(x,y,x,y+1,Material::Oil,Material::Sand);
-                } else if (dbc == Material::Fire) {
-                    killDot(x,y+1);
-
-                } else if (m_world->dot(x-1,y) == Material::Air && myrandom()<0.01) {
-                    moveDot(x,y,x-1,y,Material::Air,Material::Sand);
-                } else if (m_world->dot(x+1,y) == Material::Air && myrandom()<0.01) {
-                    moveDot(x,y,x+1,y,Material::Air,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x+1,y+1) == Material::Air
-                           && m_world->dot(x+1,y) == Material::Air
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x+1,y,Material::Air,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x+1,y) == Material::Water
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x+1,y,Material::Water,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x-1,y) == Material::Water
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x-1,y,Material::Water,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x+1,y) == Material::Oil
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x+1,y,Material::Oil,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x-1,y) == Material::Oil
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x-1,y,Material::Oil,Material::Sand);
-
-                } else if (dbc != Material::Air
-                           && m_world->dot(x-1,y) == Material::Air
-                           && m_world->dot(x-1,y+1) == Material::Air
-                           && myrandom()<0.3) {
-                    moveDot(x,y,x-1,y,Material::Air,Material::Sand);
-                }
-            }
+        if (dbc == Material::Fire && myrandom()<0.2) {
+            RULE_HIT(Rule::OilSinkFire);
+            moveDot(x,y,x,y+1,Material::Fire,Material::Oil);
+        } else if (dbc == Material::Air) {
+            RULE_HIT(Rule::OilFall);
+            if (myrandom()<0.7)
+                moveDot(x,y,x,y+1,Material::Air,Material::Oil);
+        } else if (dbc == Material::Fire && myrandom()<0.1) {
+            RULE_HIT(Rule::OilIgnite);
+            addDot(x,y,Material::Fire);
+        } else if (dbc == Material::Air && myrandom()<0.05) {
+            RULE_HIT(Rule::OilDrip);
+            addDot(x,y+1,Material::Oil);
+        } else if (dbc != Material::Air) {
+            RULE_HIT(Rule::OilSpread);
+            liquid(layout,x,y,Material::Oil);
+        }
+    }
+        break;
+    case Material::Plasma:
+    {
+        RULE_BEGIN(Rule::PlasmaIdle);
 
-                break;
-            case Material::Steam:
-            {
-                if ( dtc != Material::Earth
-                     && dtc != Material::Rock
-                     && dtc != Material::Steam && myrandom()<0.5) {
-                    moveDot(x,y,x,y-1,dtc,Material::Steam);
-                } else if (myrandom()<0.3
-                           && dtc != Material::Air
-                           && m_world->dot(x-1,y) == Material::Air
-                           && m_world->dot(x-1,y+1) != Material::Steam) {
-                    moveDot(x,y,x-1,y,Material::Air, Material::Steam);
-                } else if (myrandom()<0.3
-                           && dtc != Material::Air
-                           && m_world->dot(x+1,y) == Material::Air
-                           && m_world->dot(x+1,y+1) != Material::Steam) {
-                    moveDot(x,y,x+1,y,Material::Air, Material::Steam);
-                } else if (myrandom()<0.3
-                           && dtc != Material::Air
-                           && m_world->dot(x+2,y) == Material::Air
-                           && m_world->dot(x+2,y+1) != Material::Steam) {
-                    moveDot(x,y,x+2,y,Material::Air, Material::Steam);
-                } else if (myrandom()<0.3
-                           && dtc != Material::Air
-                           && m_world->dot(x-2,y) == Material::Air
-                           && m_world->dot(x-2,y+1) != Material::Steam) {
-                    moveDot(x,y,x-2,y,Material::Air, Material::Steam);
-                }
-                if (myrandom()<0.03 || y<1) {
-                    killDot(x,y);
-                }
-            }
-                break;
-            case Material::Water:
-            {
-                if (dbc == Material::Air) {
-                    if (myrandom()<0.95)
-                        moveDot(x,y,x,y+1,Material::Air,Material::Water);
-                } else if (dbc == Material::Fire) {
-                    moveDot(x,y,x,y+1, Material::Steam, Material::Water);
-                } else if (m_world->dot(x+1,y) == Material::Fire) {
-                    addDot(x,y,Material::Steam);
-                    killDot(x+1,y);
-                } else if (m_world->dot(x-1,y) == Material::Fire) {
-                    addDot(x, y, Material::Steam);
-                    killDot(x-1, y);
-                } else if (dbc==Material::Oil && myrandom()<0.3) {
-                    moveDot(x,y,x,y+1,Material::Oil,Material::Water);
-                } else if (dbc==Material::Acid && myrandom()<0.01) {
-                    killDot(x,y+1);
-                } else if (m_world->dot(x+1,y)==Material::Oil && myrandom()<0.1) {
-                    moveDot(x+1,y,x,y,Material::Water,Material::Oil);
-                } else if (m_world->dot(x-1,y)==Material::Oil && myrandom()<0.1) {
-                    moveDot(x-1,y,x,y,Material::Water,Material::Oil);
-
-                    // } else if (m_world_new->dot(x+1,y)==Brush::Acid && random()<0.4) {
-                    //     moveDot(x+1,y,x,y,Material::Water,Brush::Acid);
-                    // } else if (m_world_new->dot(x-1,y)==Brush::Acid && random()<0.4) {
-                    //     moveDot(x-1,y,x,y,Material::Water,Brush::Acid);
-
-                } else {
-                    liquid(x,y,Material::Water);
-                }
-            }
-                break;
-            default:
-                Q_UNREACHABLE();
-                break;
-            }
+        if (myrandom()<0.1) {
+            RULE_HIT(Rule::PlasmaDecay);
+            killDot(x,y);
+        }
+    }
+        break;
+    case Material::Sand:
+    {
+        RULE_BEGIN(Rule::SandIdle);
+
+        if (dbc == Material::Air) {
+            RULE_HIT(Rule::SandFall);
+            if (myrandom()<0.9)
+                moveDot(x,y,x,y+1,Material::Air,Material::Sand);
+        } else if (dbc == Material::Water) {
+            RULE_HIT(Rule::SandSinkWater);
+            if (myrandom()<0.6)
+                moveDot(x,y,x,y+1,Material::Water,Material::Sand);
+        } else if (dbc == Material::Acid) {
+            RULE_HIT(Rule::SandSinkAcid);
+            if (myrandom()<0.1)
+                moveDot(x,y,x,y+1,Material::Acid,Material::Sand);
+        } else if (dbc == Material::Oil) {
+            RULE_HIT(Rule::SandSinkOil);
+            if (myrandom()<0.3)
+                moveDot(x,y,x,y+1,Material::Oil,Material::Sand);
+        } else if (dbc == Material::Fire) {
+            RULE_HIT(Rule::SandQuenchFire);
+            killDot(x,y+1);
+
+        } else if (layout.dot(x-1,y) == Material::Air && myrandom()<0.01) {
+            RULE_HIT(Rule::SandSlideLeft);
+            moveDot(x,y,x-1,y,Material::Air,Material::Sand);
+        } else if (layout.dot(x+1,y) == Material::Air && myrandom()<0.01) {
+            RULE_HIT(Rule::SandSlideRight);
+            moveDot(x,y,x+1,y,Material::Air,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x+1,y+1) == Material::Air
+                   && layout.dot(x+1,y) == Material::Air
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandToppleRight);
+            moveDot(x,y,x+1,y,Material::Air,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x+1,y) == Material::Water
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandSwapWaterRight);
+            moveDot(x,y,x+1,y,Material::Water,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x-1,y) == Material::Water
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandSwapWaterLeft);
+            moveDot(x,y,x-1,y,Material::Water,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x+1,y) == Material::Oil
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandSwapOilRight);
+            moveDot(x,y,x+1,y,Material::Oil,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x-1,y) == Material::Oil
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandSwapOilLeft);
+            moveDot(x,y,x-1,y,Material::Oil,Material::Sand);
+
+        } else if (dbc != Material::Air
+                   && layout.dot(x-1,y) == Material::Air
+                   && layout.dot(x-1,y+1) == Material::Air
+                   && myrandom()<0.3) {
+            RULE_HIT(Rule::SandToppleLeft);
+            moveDot(x,y,x-1,y,Material::Air,Material::Sand);
+        }
+    }
+
+        break;
+    case Material::Steam:
+    {
+        RULE_BEGIN(Rule::SteamIdle);
+
+        if ( dtc != Material::Earth
+             && dtc != Material::Rock
+             && dtc != Material::Steam && myrandom()<0.5) {
+            RULE_HIT(Rule::SteamRise);
+            moveDot(x,y,x,y-1,dtc,Material::Steam);
+        } else if (myrandom()<0.3
+                   && dtc != Material::Air
+                   && layout.dot(x-1,y) == Material::Air
+                   && layout.dot(x-1,y+1) != Material::Steam) {
+            RULE_HIT(Rule::SteamDriftLeft);
+            moveDot(x,y,x-1,y,Material::Air, Material::Steam);
+        } else if (myrandom()<0.3
+                   && dtc != Material::Air
+                   && layout.dot(x+1,y) == Material::Air
+                   && layout.dot(x+1,y+1) != Material::Steam) {
+            RULE_HIT(Rule::SteamDriftRight);
+            moveDot(x,y,x+1,y,Material::Air, Material::Steam);
+        } else if (myrandom()<0.3
+                   && dtc != Material::Air
+                   && layout.dot(x+2,y) == Material::Air
+                   && layout.dot(x+2,y+1) != Material::Steam) {
+            RULE_HIT(Rule::SteamDriftFarRight);
+            moveDot(x,y,x+2,y,Material::Air, Material::Steam);
+        } else if (myrandom()<0.3
+                   && dtc != Material::Air
+                   && layout.dot(x-2,y) == Material::Air
+                   && layout.dot(x-2,y+1) != Material::Steam) {
+            RULE_HIT(Rule::SteamDriftFarLeft);
+            moveDot(x,y,x-2,y,Material::Air, Material::Steam);
+        }
+        if (myrandom()<0.03 || y<1) {
+            RULE_HIT(Rule::SteamCondense);
+            killDot(x,y);
+        }
+    }
+        break;
+    case Material::Water:
+    {
+        RULE_BEGIN(Rule::WaterIdle);
+
+        if (dbc == Material::Air) {
+            RULE_HIT(Rule::WaterFall);
+            if (myrandom()<0.95)
+                moveDot(x,y,x,y+1,Material::Air,Material::Water);
+        } else if (dbc == Material::Fire) {
+            RULE_HIT(Rule::WaterBoil);
+            moveDot(x,y,x,y+1, Material::Steam, Material::Water);
+        } else if (layout.dot(x+1,y) == Material::Fire) {
+            RULE_HIT(Rule::WaterQuenchRight);
+            addDot(x,y,Material::Steam);
+            killDot(x+1,y);
+        } else if (layout.dot(x-1,y) == Material::Fire) {
+            RULE_HIT(Rule::WaterQuenchLeft);
+            addDot(x, y, Material::Steam);
+            killDot(x-1, y);
+        } else if (dbc==Material::Oil && myrandom()<0.3) {
+            RULE_HIT(Rule::WaterSinkOil);
+            moveDot(x,y,x,y+1,Material::Oil,Material::Water);
+        } else if (dbc==Material::Acid && myrandom()<0.01) {
+            RULE_HIT(Rule::WaterDiluteAcid);
+            killDot(x,y+1);
+        } else if (layout.dot(x+1,y)==Material::Oil && myrandom()<0.1) {
+            RULE_HIT(Rule::WaterSwapOilRight);
+            moveDot(x+1,y,x,y,Material::Water,Material::Oil);
+        } else if (layout.dot(x-1,y)==Material::Oil && myrandom()<0.1) {
+            RULE_HIT(Rule::WaterSwapOilLeft);
+            moveDot(x-1,y,x,y,Material::Water,Material::Oil);
+
+            // } else if (m_world_new->dot(x+1,y)==Brush::Acid && random()<0.4) {
+            //     moveDot(x+1,y,x,y,Material::Water,Brush::Acid);
+            // } else if (m_world_new->dot(x-1,y)==Brush::Acid && random()<0.4) {
+            //     moveDot(x-1,y,x,y,Material::Water,Brush::Acid);
+
+        } else {
+            RULE_HIT(Rule::WaterSpread);
+            liquid(layout,x,y,Material::Water);
+        }
+    }
+        break;
+    default:
+        /* A material of the definition file, without rules */
+        break;
+    }
+}
+
+void GameEngine::updateGame()
+{
+    TRACE_SCOPE("GameEngine::updateGame");
+
+    processCommands();
+
+    ++m_tick;
+    m_moveSources.clear();
+
+    const bool chunkStats = m_chunkStatsEnabled;
+    if (chunkStats) {
+        m_chunkStats.beginStep(m_world->width(), m_world->height());
+    }
+
+    /* Pick the layout of the cells known at compile time, if any */
+    const GameWorld *world = m_world.data();
+    if (world->width() == C_DEFAULT_WIDTH && world->height() == C_DEFAULT_HEIGHT) {
+        stepRows(GameFixedLayout<C_DEFAULT_WIDTH, C_DEFAULT_HEIGHT>(world));
+    } else if (world->width() == world->bytesPerLine()) {
+        switch (world->width()) {
+        case   64: stepRows(GamePow2Layout< 6>(world)); break;
+        case  128: stepRows(GamePow2Layout< 7>(world)); break;
+        case  256: stepRows(GamePow2Layout< 8>(world)); break;
+        case  512: stepRows(GamePow2Layout< 9>(world)); break;
+        case 1024: stepRows(GamePow2Layout<10>(world)); break;
+        case 2048: stepRows(GamePow2Layout<11>(world)); break;
+        case 4096: stepRows(GamePow2Layout<12>(world)); break;
+        default:   stepRows(GameStrideLayout(world)); break;
+        }
+    } else {
+        stepRows(GameStrideLayout(world));
+    }
+
+    if (m_ruleStatsEnabled) {
+        m_ruleStats.endStep();
+        m_ruleStatsTotal += m_ruleStats;
+        m_ruleStatsLastStep = m_ruleStats;
+        m_ruleStats.clear();
+    }
+    if (chunkStats) {
+        m_chunkStats.endStep(m_world->dirtyRects());
+    }
+    takeDirtyRects();
+    m_idleSteps = (m_dirtyRects.isEmpty() && !isInputActive()) ? m_idleSteps + 1 : 0;
+    if (m_publisher && !m_publisher->publish(m_world.data(), m_tick)) {
+        qWarning("%s", qPrintable(m_publisher->errorString()));
+        m_publisher.reset();
+    }
+    if (m_recorder) {
+        if (!m_recorder->record(m_world.data(), m_recordRects, m_tick)) {
+            qWarning("%s", qPrintable(m_recorder->errorString()));
+            m_recorder.reset();
         }
+        m_recordRects.clear();
     }
     emit changed();
+    emit populationChanged();
+
+    /* The world is static: the next steps would do nothing */
+    if (m_idleSteps >= C_IDLE_STEPS && m_updateTimer->isActive()) {
+        m_updateTimer->stop();
+        m_fountainTimer->stop();
+        m_isIdle = true;
+    }
+}
+
+/*!
+ * \brief Apply the first matching rule of the range [\a rule, \a lastRule).
+ *
+ * \sa GameMaterialRules
+ */
+inline void GameEngine::applyRules(const int x, const int y,
+                                   const MaterialRule *rule, const MaterialRule *lastRule)
+{
+    for ( ; rule != lastRule; ++rule) {
+        const int nx = x + rule->dx;
+        const int ny = y + rule->dy;
+        if (rule->required != MaterialRule::AnyMaterial) {
+            const bool same = (m_world->dot(nx, ny) == (Material)rule->required);
+            if (same == rule->negated)
+                continue;
+        }
+        if (rule->probability < 1.0f && myrandom() >= rule->probability) {
+            if (rule->fallthrough)
+                continue;
+            return;
+        }
+        if (rule->self != MaterialRule::KeepMaterial) {
+            addDot(x, y, (Material)rule->self);
+        }
+        if (rule->target != MaterialRule::KeepMaterial) {
+            addDot(nx, ny, (Material)rule->target);
+            if (rule->self != MaterialRule::KeepMaterial) {
+                recordMove(x, y, nx, ny);
+            }
+        }
+        return;
+    }
 }
 
 /***********************************************************************************
@@ -465,14 +1219,15 @@ inline void GameEngine::boom(const int x, const int y, const Material mat)
     }
 }
 
-inline void GameEngine::liquid(const int x, const int y, const Material mat)
+template <class Layout>
+inline void GameEngine::liquid(const Layout &layout, const int x, const int y, const Material mat)
 {
-    const Material r1 = m_world->dot(x+1,y);
-    const Material r2 = m_world->dot(x+2,y);
-    const Material r3 = m_world->dot(x+3,y);
-    const Material l1 = m_world->dot(x-1,y);
-    const Material l2 = m_world->dot(x-2,y);
-    const Material l3 = m_world->dot(x-3,y);
+    const Material r1 = layout.dot(x+1,y);
+    const Material r2 = layout.dot(x+2,y);
+    const Material r3 = layout.dot(x+3,y);
+    const Material l1 = layout.dot(x-1,y);
+    const Material l2 = layout.dot(x-2,y);
+    const Material l3 = layout.dot(x-3,y);
 
     const int w = ((r1==mat) ? 1 : 0 )
             + ( (r2==mat) ? 1 : 0 )
@@ -482,13 +1237,13 @@ inline void GameEngine::liquid(const int x, const int y, const Material mat)
             - ( (l3==mat) ? 1 : 0 );
 
     if (w<=0 && myrandom()<0.5) {
-        if      (r1==Material::Air && m_world->dot(x+1,y-1)!=mat) moveDot(x,y,x+1,y,Material::Air,mat);
-        else if (r2==Material::Air && m_world->dot(x+2,y-1)!=mat) moveDot(x,y,x+2,y,Material::Air,mat);
-        else if (r3==Material::Air && m_world->dot(x+3,y-1)!=mat) moveDot(x,y,x+3,y,Material::Air,mat);
+        if      (r1==Material::Air && layout.dot(x+1,y-1)!=mat) moveDot(x,y,x+1,y,Material::Air,mat);
+        else if (r2==Material::Air && layout.dot(x+2,y-1)!=mat) moveDot(x,y,x+2,y,Material::Air,mat);
+        else if (r3==Material::Air && layout.dot(x+3,y-1)!=mat) moveDot(x,y,x+3,y,Material::Air,mat);
     } else if (w>=0 && myrandom()<0.5) {
-        if      (l1==Material::Air && m_world->dot(x-1,y-1)!=mat) moveDot(x,y,x-1,y,Material::Air,mat);
-        else if (l2==Material::Air && m_world->dot(x-2,y-1)!=mat) moveDot(x,y,x-2,y,Material::Air,mat);
-        else if (l3==Material::Air && m_world->dot(x-3,y-1)!=mat) moveDot(x,y,x-3,y,Material::Air,mat);
+        if      (l1==Material::Air && layout.dot(x-1,y-1)!=mat) moveDot(x,y,x-1,y,Material::Air,mat);
+        else if (l2==Material::Air && layout.dot(x-2,y-1)!=mat) moveDot(x,y,x-2,y,Material::Air,mat);
+        else if (l3==Material::Air && layout.dot(x-3,y-1)!=mat) moveDot(x,y,x-3,y,Material::Air,mat);
     }
 }
 
@@ -496,9 +1251,12 @@ inline void GameEngine::liquid(const int x, const int y, const Material mat)
  ***********************************************************************************/
 inline void GameEngine::addDot(const int x, const int y, const Material mat)
 {
-    m_world->setDot(x,y,mat);
-    ColorVariation c = computeRandomColor(mat);
-    m_world->setColorVariation(x,y,c);
+    if (m_hashedColorsEnabled) {
+        const uint salt = (uint)(m_tick >> C_HASHED_COLOR_TICK_SHIFT);
+        m_world->setDot(x,y,mat,computeHashedColor(mat,x,y,salt));
+    } else {
+        m_world->setDot(x,y,mat,computeRandomColor(mat));
+    }
 }
 
 inline void GameEngine::moveDot(const int x, const int y,
@@ -507,6 +1265,7 @@ inline void GameEngine::moveDot(const int x, const int y,
 {
     addDot(x,y,mat);
     addDot(nx,ny,nMat);
+    recordMove(x,y,nx,ny);
 }
 
 inline void GameEngine::killDot(const int x, const int y)
@@ -514,14 +1273,30 @@ inline void GameEngine::killDot(const int x, const int y)
     addDot(x,y,Material::Air);
 }
 
+/* The dot (x,y) of the step rows moved to (nx,ny), out of the step rows */
+inline void GameEngine::recordMove(const int x, const int y, const int nx, const int ny)
+{
+    if ((ny < m_firstStepRow || ny > m_lastStepRow)
+            && nx >= 0 && ny >= 0 && nx < m_world->width() && ny < m_world->height()
+            && y >= m_firstStepRow && y <= m_lastStepRow) {
+        m_moveSources.insert(ny * m_world->width() + nx, QPoint(x, y));
+    }
+}
+
 /***********************************************************************************
  ***********************************************************************************/
 void GameEngine::spawnFountain()
 {
-    for (int i = 0; i < m_fountains.count(); ++i) {
+    TRACE_SCOPE("GameEngine::spawnFountain");
+
+    for (int i = 0; m_fountainsEnabled && i < m_fountains.count(); ++i) {
         spawnDot(m_fountains.at(i).x, m_fountains.at(i).y, m_fountains.at(i).type);
     }
     spawnMouse();
+    takeDirtyRects();
+    if (!m_dirtyRects.isEmpty()) {
+        m_idleSteps = 0;
+    }
     emit changed();
 }
 
@@ -543,11 +1318,31 @@ inline void GameEngine::spawnDot(const int x, const int y, const Material mat)
     }
 }
 
+inline void GameEngine::spawnLine(const int x1, const int y1, const int x2, const int y2,
+                                  const Material mat)
+{
+    const double dx = x2 - x1;
+    const double dy = y2 - y1;
+    const double length = std::sqrt(std::pow(dx, 2) + std::pow(dy, 2));
+
+    for (int i = 0; i < qCeil(length); ++i) {
+        const double pc = (double)i/length;
+        const int xx = x1 + dx*pc;
+        const int yy = y1 + dy*pc;
+        spawnDot(xx, yy, mat);
+    }
+}
+
 inline void GameEngine::spawnMouse()
 {
     if (m_isMousePressed) {
         spawnDot(m_mousePosX, m_mousePosY, m_currentMaterial);
     }
+    foreach (const Brush &brush, m_brushes) {
+        if (brush.isPressed) {
+            spawnDot(brush.x, brush.y, brush.material);
+        }
+    }
 }
 
 
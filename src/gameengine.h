@@ -25,13 +25,25 @@
 #ifndef GAME_ENGINE_H
 #define GAME_ENGINE_H
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
 #include <QtCore/QObject>
+#include <QtCore/QRect>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
 
+#include "gamechunkstats.h"
+#include "gamecommandqueue.h"
 #include "gamematerial.h"
+#include "gamerulestats.h"
 
 class QTimer;
+class GameFramePublisher;
+class GameRecorder;
 class GameWorld;
+class GameWorldGenerator;
+struct MaterialRule;
 class GameEngine : public QObject
 {
     Q_OBJECT
@@ -42,6 +54,13 @@ class GameEngine : public QObject
         Material type;
     };
 
+    struct Brush {
+        bool isPressed;
+        int x;
+        int y;
+        Material material;
+    };
+
 public:
     explicit GameEngine(QObject *parent = 0);
     ~GameEngine();
@@ -55,16 +74,70 @@ public:
     int height() const;
     void setSize(const int width, const int height);
 
+    int population(const Material material) const;
+
+    void generate(GameWorldGenerator *generator, const uint seed,
+                  const QPoint &origin = QPoint(), const QSize &size = QSize());
+
+    QVector<QRect> dirtyRects() const;
+
+    bool isRuleStatsEnabled() const;
+    void setRuleStatsEnabled(const bool enabled);
+    GameRuleStats ruleStats() const;
+    GameRuleStats ruleStatsTotal() const;
+    void resetRuleStats();
+
+    bool isChunkStatsEnabled() const;
+    void setChunkStatsEnabled(const bool enabled);
+    GameChunkStats chunkStats() const;
+
+    bool isRunning() const;
+    void setRunning(const bool running);
+    bool isIdle() const;
+    quint64 tick() const;
+
+    static int maxReach();
+    void setStepRows(const int first, const int last);
+    bool moveSource(const int x, const int y, QPoint *source) const;
+    bool isFountainsEnabled() const;
+    void setFountainsEnabled(const bool enabled);
+
+    bool isHashedColorsEnabled() const;
+    void setHashedColorsEnabled(const bool enabled);
+
+    bool isPublishing() const;
+    bool startPublishing(const QString &name, const int slotCount,
+                         QString *errorString = Q_NULLPTR);
+    void stopPublishing();
+
+    bool isRecording() const;
+    bool startRecording(const QString &fileName, const int keyframeInterval,
+                        QString *errorString = Q_NULLPTR);
+    void stopRecording();
+
+    bool post(const GameCommand &command);
+
     void setMousePressed(const bool pressed);
     void moveMouseTo(const int posX, const int posY);
 
+    void setBrush(const int id, const bool pressed, const int x, const int y,
+                  const Material material);
+    void removeBrush(const int id);
+
+    void commitChanges();
+
 Q_SIGNALS:
     void changed();
     void sizeChanged();
+    void populationChanged();
+    void mouseChanged(bool pressed, int x, int y);
 
 public Q_SLOTS:
     void clear();
     void fillRandomly();
+    void step();
+    void processCommands();
+    void wake();
 
 private Q_SLOTS:
     void updateGame();
@@ -79,18 +152,51 @@ private:
     int m_mousePosY;
     Material m_currentMaterial;
     QList<Fountain> m_fountains;
+    QHash<int, Brush> m_brushes;
+    GameCommandQueue m_commands;
+    QAtomicInt m_commandsPending;
+    QVector<QRect> m_dirtyRects;
+    bool m_ruleStatsEnabled;
+    GameRuleStats m_ruleStats;
+    GameRuleStats m_ruleStatsLastStep;
+    GameRuleStats m_ruleStatsTotal;
+    bool m_chunkStatsEnabled;
+    GameChunkStats m_chunkStats;
+    quint64 m_tick;
+    int m_firstStepRow;
+    int m_lastStepRow;
+    QHash<int, QPoint> m_moveSources;  /* dots moved out of the step rows */
+    bool m_fountainsEnabled;
+    bool m_hashedColorsEnabled;
+    bool m_isIdle;
+    int m_idleSteps;
+    QScopedPointer<GameFramePublisher> m_publisher;
+    QScopedPointer<GameRecorder> m_recorder;
+    QVector<QRect> m_recordRects;  /* modified since the last record */
 
     void resetFountains();
+    inline bool isInputActive() const;
+    inline void takeDirtyRects();
 
     inline void boom(const int x, const int y, const Material mat);
-    inline void liquid(const int x, const int y, const Material mat);
+    template <class Layout>
+    void stepRows(const Layout &layout);
+    template <class Layout>
+    inline void stepDot(const Layout &layout, const int x, const int y);
+    template <class Layout>
+    inline void liquid(const Layout &layout, const int x, const int y, const Material mat);
+    inline void applyRules(const int x, const int y,
+                           const MaterialRule *rule, const MaterialRule *lastRule);
 
     inline void addDot(const int x, const int y, const Material mat);
     inline void moveDot(const int x, const int y, const int nx, const int ny,
                         const Material mat, const Material nMat);
     inline void killDot(const int x, const int y);
+    inline void recordMove(const int x, const int y, const int nx, const int ny);
 
     inline void spawnDot(const int x, const int y, const Material mat);
+    inline void spawnLine(const int x1, const int y1, const int x2, const int y2,
+                          const Material mat);
     inline void spawnMouse();
 
 };
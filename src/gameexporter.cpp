@@ -0,0 +1,205 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameexporter.h"
+#include "gamematerial.h"
+#include "gameworld.h"
+#include "gametracer.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QFileInfo>
+#include <QtConcurrent/QtConcurrent>
+
+#define C_EXPORT_BACKGROUND_COLOR qRgb(255, 255, 255) // Air
+
+/*! \class GameExporter
+ *  \brief The class GameExporter writes frames of the world without display.
+ *
+ * The output is either:
+ * \list
+ * \li a file name pattern, where "%1" is replaced by the frame number,
+ *     e.g. "frames/frame_%1.png". The extension gives the format, PNG or PPM.
+ * \li "-", to write raw RGB24 frames to the standard output,
+ *     e.g. to pipe them into a video encoder.
+ * \endlist
+ *
+ * exportFrame() only copies the world's dots (one byte per dot).
+ * The frame is then converted and encoded on a worker thread,
+ * so that the encoding overlaps the simulation.
+ *
+ * The pipeline is bounded: when \a maxPendingFrames frames are
+ * being encoded, exportFrame() waits for the oldest one.
+ * The frames are written to the standard output in order.
+ *
+ * \sa GameEngine::step()
+ */
+
+/*
+ * Convert and encode the frame. Called on a worker thread.
+ * The files are written by the worker too.
+ * The raw frames are returned, to be written in order.
+ */
+static QByteArray encodeFrame(const QImage &dots, const GameExporter::Format format,
+                              const QString &fileName)
+{
+    TRACE_SCOPE("GameExporter::encodeFrame");
+
+    /* Air is transparent in the palette, but the export has no alpha */
+    QImage indexed = dots;
+    QVector<QRgb> colors = indexed.colorTable();
+    for (int i = 0; i < colors.count(); ++i) {
+        if (qAlpha(colors.at(i)) == 0) {
+            colors[i] = C_EXPORT_BACKGROUND_COLOR;
+        }
+    }
+    indexed.setColorTable(colors);
+    const QImage rgb = indexed.convertToFormat(QImage::Format_RGB888);
+
+    QByteArray bytes;
+    if (format == GameExporter::PngFormat) {
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        rgb.save(&buffer, "PNG");
+    } else {
+        if (format == GameExporter::PpmFormat) {
+            bytes += QString("P6\n%1 %2\n255\n").arg(rgb.width()).arg(rgb.height()).toLatin1();
+        }
+        /* The scanlines are 32-bit aligned: copy only the pixels */
+        const int lineSize = 3 * rgb.width();
+        bytes.reserve(bytes.size() + lineSize * rgb.height());
+        for (int y = 0; y < rgb.height(); ++y) {
+            bytes.append(reinterpret_cast<const char*>(rgb.constScanLine(y)), lineSize);
+        }
+    }
+
+    if (format == GameExporter::RawFormat) {
+        return bytes;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size()) {
+        return QByteArray(); // error reported by writeOldest()
+    }
+    return QByteArray("ok");
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameExporter::GameExporter(const QString &output, const int maxPendingFrames)
+  : m_output(output)
+  , m_format(RawFormat)
+  , m_maxPendingFrames(qMax(1, maxPendingFrames))
+  , m_frameCount(0)
+{
+    if (m_output != QLatin1String("-")) {
+        const QString suffix = QFileInfo(m_output).suffix().toLower();
+        m_format = (suffix == QLatin1String("ppm")) ? PpmFormat : PngFormat;
+    }
+}
+
+GameExporter::~GameExporter()
+{
+    finish();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameExporter::open()
+{
+    if (m_format == RawFormat) {
+        if (!m_stream.open(stdout, QIODevice::WriteOnly)) {
+            m_errorString = m_stream.errorString();
+            return false;
+        }
+    } else if (!m_output.contains(QLatin1String("%1"))) {
+        m_errorString = QLatin1String("The output file name must contain '%1' for the frame number.");
+        return false;
+    }
+    return true;
+}
+
+QString GameExporter::errorString() const
+{
+    return m_errorString;
+}
+
+int GameExporter::frameCount() const
+{
+    return m_frameCount;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Export the current state of the \a world, as the next frame.
+ *
+ * Return false if a previous frame couldn't be written.
+ */
+bool GameExporter::exportFrame(const GameWorld *world)
+{
+    TRACE_SCOPE("GameExporter::exportFrame");
+
+    /* Bounded pipeline: wait for the oldest frame */
+    while (m_pending.count() >= m_maxPendingFrames) {
+        if (!writeOldest())
+            return false;
+    }
+
+    const QImage dots = world->indexedImage().copy();
+    const QString fileName = (m_format == RawFormat)
+            ? QString()
+            : m_output.arg(m_frameCount, 6, 10, QLatin1Char('0'));
+    m_pending.enqueue(QtConcurrent::run(encodeFrame, dots, m_format, fileName));
+    m_frameCount++;
+    return true;
+}
+
+/*!
+ * \brief Wait for all the pending frames to be written.
+ */
+bool GameExporter::finish()
+{
+    bool ok = true;
+    while (!m_pending.isEmpty()) {
+        ok = writeOldest() && ok;
+    }
+    if (m_stream.isOpen()) {
+        m_stream.flush();
+    }
+    return ok;
+}
+
+bool GameExporter::writeOldest()
+{
+    QFuture<QByteArray> future = m_pending.dequeue();
+    const QByteArray bytes = future.result();
+    if (bytes.isEmpty()) {
+        m_errorString = QString("Can't write the frame.");
+        return false;
+    }
+    if (m_format == RawFormat && m_stream.write(bytes) != bytes.size()) {
+        m_errorString = m_stream.errorString();
+        return false;
+    }
+    return true;
+}
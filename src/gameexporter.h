@@ -0,0 +1,68 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_EXPORTER_H
+#define GAME_EXPORTER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QFuture>
+#include <QtCore/QQueue>
+#include <QtCore/QString>
+#include <QtGui/QImage>
+
+class GameWorld;
+class GameExporter
+{
+public:
+    enum Format {
+        PpmFormat,  /* one binary PPM file per frame */
+        PngFormat,  /* one PNG file per frame */
+        RawFormat   /* raw RGB24 frames, concatenated in a single stream */
+    };
+
+    explicit GameExporter(const QString &output, const int maxPendingFrames);
+    ~GameExporter();
+
+    bool open();
+    QString errorString() const;
+
+    bool exportFrame(const GameWorld *world);
+    bool finish();
+
+    int frameCount() const;
+
+private:
+    QString m_output;
+    Format m_format;
+    int m_maxPendingFrames;
+    int m_frameCount;
+    QFile m_stream;
+    QString m_errorString;
+    QQueue<QFuture<QByteArray> > m_pending;
+
+    bool writeOldest();
+};
+
+#endif // GAME_EXPORTER_H
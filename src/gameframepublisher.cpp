@@ -0,0 +1,203 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameframepublisher.h"
+#include "gameframering.h"
+#include "gamematerial.h"
+#include "gametracer.h"
+#include "gameworld.h"
+
+#include <QtCore/QFile>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+/*! \class GameFramePublisher
+ *  \brief The class GameFramePublisher publishes the frames of the world
+ *  into a POSIX shared-memory ring, for other processes.
+ *
+ * The segment is created with shm_open() under the given \a name
+ * (e.g. "/elementdots"), and contains \a slotCount frames.
+ * Its layout is described in gameframering.h.
+ *
+ * publish() only copies the world's cells (one byte per dot) into the next
+ * slot: the readers convert them with the color table of the header.
+ * The publisher never waits for the readers: a slow reader skips frames,
+ * and detects the frames overwritten while being read.
+ *
+ * See tools/shmreader for a reference reader.
+ *
+ * \sa GameEngine::startPublishing()
+ */
+
+GameFramePublisher::GameFramePublisher(const QString &name, const int slotCount)
+  : m_name(name.startsWith(QLatin1Char('/')) ? name : QLatin1Char('/') + name)
+  , m_slotCount(qMax(2, slotCount))
+  , m_header(Q_NULLPTR)
+  , m_size(0)
+  , m_frameCount(0)
+{
+}
+
+GameFramePublisher::~GameFramePublisher()
+{
+    destroy();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+QString GameFramePublisher::name() const
+{
+    return m_name;
+}
+
+QString GameFramePublisher::errorString() const
+{
+    return m_errorString;
+}
+
+quint64 GameFramePublisher::frameCount() const
+{
+    return m_frameCount;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Copy the dots of the \a world into the next slot of the ring.
+ *
+ * The segment is created on the first call, and replaced
+ * when the size of the world changes.
+ */
+bool GameFramePublisher::publish(const GameWorld *world, const quint64 tick)
+{
+    TRACE_SCOPE("GameFramePublisher::publish");
+
+    const int width = world->width();
+    const int height = world->height();
+    if (width <= 0 || height <= 0) {
+        return true;
+    }
+    if (m_header && (m_header->width != (quint32)width || m_header->height != (quint32)height)) {
+        destroy();
+    }
+    if (!m_header && !create(width, height, world->bytesPerLine())) {
+        return false;
+    }
+
+    const quint64 frame = ++m_frameCount;
+    GameFrameRingSlot *slot = frameRingSlot(m_header, frame);
+
+    /* The readers must see the slot as incomplete before it's modified */
+    slot->sequence.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(frameRingCells(slot), world->constScanLine(0), (size_t)m_header->stride * height);
+    slot->tick = tick;
+
+    slot->sequence.storeRelease(frame);
+    m_header->head.storeRelease(frame);
+    return true;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameFramePublisher::create(const int width, const int height, const int stride)
+{
+#ifdef Q_OS_UNIX
+    const QByteArray name = QFile::encodeName(m_name);
+    const quint64 slotSize = frameRingSlotSize(stride, height);
+    const quint64 size = frameRingHeaderSize() + m_slotCount * slotSize;
+
+    /* A segment left by a publisher that crashed */
+    shm_unlink(name.constData());
+
+    const int fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        m_errorString = QString("Cannot create the shared memory '%0': %1")
+                .arg(m_name).arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        data = mmap(Q_NULLPTR, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        m_errorString = QString("Cannot map the shared memory '%0': %1")
+                .arg(m_name).arg(QString::fromLocal8Bit(strerror(errno)));
+        ::close(fd);
+        shm_unlink(name.constData());
+        return false;
+    }
+    ::close(fd);
+
+    /* The new segment is filled with zeros */
+    m_header = (GameFrameRingHeader*)data;
+    m_size = size;
+    m_header->version = C_FRAME_RING_VERSION;
+    m_header->width = width;
+    m_header->height = height;
+    m_header->stride = stride;
+    m_header->slotCount = m_slotCount;
+    m_header->slotSize = slotSize;
+    const QVector<QRgb> colors = materialColorTable();
+    for (int i = 0; i < colors.count() && i < 256; ++i) {
+        m_header->colors[i] = colors.at(i);
+    }
+    m_header->magic.storeRelease(C_FRAME_RING_MAGIC);
+    return true;
+#else
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+    Q_UNUSED(stride);
+    m_errorString = QLatin1String("The shared memory frames require a POSIX system.");
+    return false;
+#endif
+}
+
+/*!
+ * \brief Tell the readers that the segment is obsolete, and remove it.
+ *
+ * The readers that still map it can finish their frame.
+ */
+void GameFramePublisher::destroy()
+{
+#ifdef Q_OS_UNIX
+    if (!m_header) {
+        return;
+    }
+    m_header->closed.storeRelease(1);
+    munmap(m_header, m_size);
+    shm_unlink(QFile::encodeName(m_name).constData());
+    m_header = Q_NULLPTR;
+    m_size = 0;
+#endif
+}
@@ -0,0 +1,56 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_FRAME_PUBLISHER_H
+#define GAME_FRAME_PUBLISHER_H
+
+#include <QtCore/QString>
+
+struct GameFrameRingHeader;
+class GameWorld;
+class GameFramePublisher
+{
+public:
+    explicit GameFramePublisher(const QString &name, const int slotCount);
+    ~GameFramePublisher();
+
+    QString name() const;
+    QString errorString() const;
+
+    bool publish(const GameWorld *world, const quint64 tick);
+    quint64 frameCount() const;
+
+private:
+    QString m_name;
+    int m_slotCount;
+    QString m_errorString;
+    GameFrameRingHeader *m_header;
+    quint64 m_size;
+    quint64 m_frameCount;
+
+    bool create(const int width, const int height, const int stride);
+    void destroy();
+};
+
+#endif // GAME_FRAME_PUBLISHER_H
@@ -0,0 +1,102 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_FRAME_RING_H
+#define GAME_FRAME_RING_H
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QtGlobal>
+
+/*
+ * Layout of the shared-memory frame ring, see GameFramePublisher.
+ *
+ * The segment starts with a GameFrameRingHeader, followed by 'slotCount'
+ * slots of 'slotSize' bytes. A slot is a GameFrameRingSlot followed by the
+ * cells of the world, 'height' rows of 'stride' bytes. A cell is the index
+ * of its color in 'colors', as in GameWorld::indexedImage().
+ *
+ * Frame N (starting at 1) is written in the slot (N - 1) % slotCount.
+ * The slot's 'sequence' is 0 while the publisher writes it, then N.
+ * The header's 'head' is the number of the last complete frame.
+ *
+ * To read without copy, a reader loads 'head', checks that the slot's
+ * 'sequence' equals it, uses the cells in place, then checks 'sequence'
+ * again: if it changed, the frame was overwritten while being read.
+ *
+ * When the size of the world changes, the publisher sets 'closed' and
+ * replaces the segment by a new one of the same name.
+ */
+
+#define C_FRAME_RING_MAGIC    0x454c4446  /* "ELDF" */
+#define C_FRAME_RING_VERSION  1
+#define C_FRAME_RING_ALIGN    64
+
+struct GameFrameRingHeader
+{
+    QAtomicInteger<quint32> magic;  /* written last, when the segment is ready */
+    quint32 version;
+    quint32 width;
+    quint32 height;
+    quint32 stride;       /* bytes per row */
+    quint32 slotCount;
+    quint64 slotSize;     /* bytes per slot, including its GameFrameRingSlot */
+    QAtomicInteger<quint64> head;
+    QAtomicInteger<quint32> closed;
+    quint32 reserved;
+    quint32 colors[256];  /* 0xAARRGGBB, as QRgb */
+};
+
+struct GameFrameRingSlot
+{
+    QAtomicInteger<quint64> sequence;
+    quint64 tick;
+};
+
+static inline quint64 frameRingAlign(const quint64 size)
+{
+    return (size + C_FRAME_RING_ALIGN - 1) & ~quint64(C_FRAME_RING_ALIGN - 1);
+}
+
+static inline quint64 frameRingHeaderSize()
+{
+    return frameRingAlign(sizeof(GameFrameRingHeader));
+}
+
+static inline quint64 frameRingSlotSize(const quint32 stride, const quint32 height)
+{
+    return frameRingAlign(sizeof(GameFrameRingSlot) + quint64(stride) * height);
+}
+
+static inline GameFrameRingSlot* frameRingSlot(GameFrameRingHeader *header, const quint64 frame)
+{
+    uchar *base = (uchar*)header + frameRingHeaderSize();
+    return (GameFrameRingSlot*)(base + ((frame - 1) % header->slotCount) * header->slotSize);
+}
+
+static inline uchar* frameRingCells(GameFrameRingSlot *slot)
+{
+    return (uchar*)slot + sizeof(GameFrameRingSlot);
+}
+
+#endif // GAME_FRAME_RING_H
@@ -0,0 +1,196 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamelodpyramid.h"
+#include "gamematerial.h"
+#include "gameworld.h"
+#include "gametracer.h"
+
+#define C_LOD_MAX_LEVELS 6 // blocks of 64x64 dots
+
+/*! \class GameLodPyramid
+ *  \brief The class GameLodPyramid holds the world at lower resolutions.
+ *
+ * The level k has one pixel per block of 2^k x 2^k dots.
+ * The pixel is the dominant material of the block, as an index of
+ * materialPalette(): the levels are Format_Indexed8 images, like
+ * GameWorld::indexedImage().
+ * The level k is computed from the 2x2 pixels of the level k-1,
+ * and the level 1 from the dots of the world.
+ *
+ * When the view is zoomed out below one pixel per dot, the widget
+ * draws the level that has about one pixel per screen pixel, so that
+ * the cost of a frame is bounded by the screen, not by the world.
+ *
+ * The pyramid is updated incrementally, from the dirty regions of the world.
+ *
+ * \sa GameWorld::takeDirtyRects()
+ */
+
+/*
+ * Return the dominant material of the given codes.
+ * Air only dominates the blocks without any other material.
+ */
+static inline uchar dominant(const uchar *codes, const int count)
+{
+    const uchar air = (uchar)((int)Material::Air << 1);
+    uchar best = air;
+    int bestCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const uchar material = codes[i] & ~1;
+        if (material == air)
+            continue;
+        int n = 0;
+        for (int j = 0; j < count; ++j) {
+            n += ((codes[j] & ~1) == material) ? 1 : 0;
+        }
+        if (n > bestCount) {
+            best = material;
+            bestCount = n;
+        }
+    }
+    return best;
+}
+
+GameLodPyramid::GameLodPyramid()
+  : m_width(0)
+  , m_height(0)
+{
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+int GameLodPyramid::levelCount() const
+{
+    return m_levels.count();
+}
+
+/*!
+ * \brief Return the image of the given \a level, from 1 to levelCount().
+ */
+QImage GameLodPyramid::level(const int level) const
+{
+    Q_ASSERT(level >= 1 && level <= m_levels.count());
+    return m_levels.at(level - 1);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameLodPyramid::clear()
+{
+    m_levels.clear();
+    m_width = 0;
+    m_height = 0;
+}
+
+/*!
+ * \brief Compute all the levels from the dots of the \a world.
+ */
+void GameLodPyramid::rebuild(const GameWorld *world)
+{
+    TRACE_SCOPE("GameLodPyramid::rebuild");
+
+    m_width = world->width();
+    m_height = world->height();
+    m_levels.clear();
+
+    int w = m_width;
+    int h = m_height;
+    for (int k = 1; k <= C_LOD_MAX_LEVELS && (w > 1 || h > 1); ++k) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        QImage image(w, h, QImage::Format_Indexed8);
+        image.setColorTable(materialColorTable());
+        m_levels << image;
+    }
+
+    for (int k = 1; k <= m_levels.count(); ++k) {
+        updateLevel(world, k, QRect(0, 0, m_width, m_height));
+    }
+}
+
+/*!
+ * \brief Update the blocks that cover the given \a rects, in dots.
+ *
+ * If the size of the \a world has changed, the pyramid is rebuilt.
+ */
+void GameLodPyramid::update(const GameWorld *world, const QVector<QRect> &rects)
+{
+    if (world->width() != m_width || world->height() != m_height) {
+        rebuild(world);
+        return;
+    }
+    TRACE_SCOPE("GameLodPyramid::update");
+
+    foreach (const QRect &rect, rects) {
+        for (int k = 1; k <= m_levels.count(); ++k) {
+            updateLevel(world, k, rect);
+        }
+    }
+}
+
+/*!
+ * \brief Recompute the pixels of the \a level that cover the \a rect, in dots.
+ *
+ * The level below must be up to date.
+ */
+inline void GameLodPyramid::updateLevel(const GameWorld *world, const int level,
+                                        const QRect &rect)
+{
+    QImage &image = m_levels[level - 1];
+
+    /* The pixels of the level covering the rect */
+    const int x1 = rect.left() >> level;
+    const int y1 = rect.top() >> level;
+    const int x2 = qMin(rect.right() >> level, image.width() - 1);
+    const int y2 = qMin(rect.bottom() >> level, image.height() - 1);
+
+    /* The source: the world for level 1, else the level below */
+    const QImage *below = (level > 1) ? &m_levels.at(level - 2) : Q_NULLPTR;
+    const int belowWidth = below ? below->width() : m_width;
+    const int belowHeight = below ? below->height() : m_height;
+
+    uchar codes[4];
+    for (int y = y1; y <= y2; ++y) {
+        uchar *line = image.scanLine(y);
+        const int sy = 2 * y;
+        const bool hasBottom = (sy + 1 < belowHeight);
+        const uchar *top = below ? below->constScanLine(sy) : world->constScanLine(sy);
+        const uchar *bottom = !hasBottom ? Q_NULLPTR
+                            : below ? below->constScanLine(sy + 1) : world->constScanLine(sy + 1);
+
+        for (int x = x1; x <= x2; ++x) {
+            const int sx = 2 * x;
+            const bool hasRight = (sx + 1 < belowWidth);
+            int count = 0;
+            codes[count++] = top[sx];
+            if (hasRight) codes[count++] = top[sx + 1];
+            if (hasBottom) {
+                codes[count++] = bottom[sx];
+                if (hasRight) codes[count++] = bottom[sx + 1];
+            }
+            line[x] = dominant(codes, count);
+        }
+    }
+}
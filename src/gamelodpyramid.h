@@ -0,0 +1,53 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_LOD_PYRAMID_H
+#define GAME_LOD_PYRAMID_H
+
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+
+class GameWorld;
+class GameLodPyramid
+{
+public:
+    explicit GameLodPyramid();
+
+    int levelCount() const;
+    QImage level(const int level) const;
+
+    void clear();
+    void rebuild(const GameWorld *world);
+    void update(const GameWorld *world, const QVector<QRect> &rects);
+
+private:
+    QVector<QImage> m_levels; /* m_levels[k-1] holds the blocks of 2^k x 2^k dots */
+    int m_width;
+    int m_height;
+
+    inline void updateLevel(const GameWorld *world, const int level, const QRect &rect);
+};
+
+#endif // GAME_LOD_PYRAMID_H
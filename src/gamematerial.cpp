@@ -25,6 +25,69 @@
 #include "gamematerial.h"
 #include "utils.h"
 
+#include <QtCore/QVector>
+#include <QtGui/QColor>
+
+/*
+ * The materials loaded from a definition file, after the built-in ones.
+ */
+struct MaterialDefinition
+{
+    QString name;
+    QString color0;
+    QString color1;
+    double colorBreak;
+    bool solid;
+    bool liquid;
+};
+
+static QVector<MaterialDefinition>& customMaterials()
+{
+    static QVector<MaterialDefinition> materials;
+    return materials;
+}
+
+static inline const MaterialDefinition& customMaterial(const Material material)
+{
+    const int index = (int)material - ((int)Material::Water + 1);
+    Q_ASSERT(index >= 0 && index < customMaterials().count());
+    return customMaterials().at(index);
+}
+
+static void rebuildPalette();
+
+int materialCount()
+{
+    return (int)Material::Water + 1 + customMaterials().count();
+}
+
+/*!
+ * \brief Add a new material, and return its value.
+ *
+ * The new materials must be registered at startup,
+ * before any world or palette is created.
+ * Return Material::Air if there are already too many materials.
+ *
+ * \sa GameMaterialRules::load()
+ */
+Material registerMaterial(const QString &name, const QString &color0, const QString &color1,
+                          const double colorBreak, const bool solid, const bool liquid)
+{
+    if (materialCount() >= C_MAX_MATERIAL_COUNT) {
+        return Material::Air;
+    }
+    MaterialDefinition definition;
+    definition.name = name.toLower();
+    definition.color0 = color0;
+    definition.color1 = color1;
+    definition.colorBreak = colorBreak;
+    definition.solid = solid;
+    definition.liquid = liquid;
+    customMaterials() << definition;
+    rebuildPalette();
+    return (Material)(materialCount() - 1);
+}
+
 QString toString(const Material material)
 {
     QString str;
@@ -40,7 +103,7 @@ QString toString(const Material material)
     case Material::Steam:  str = QLatin1String("Material::Steam"); break;
     case Material::Water:  str = QLatin1String("Material::Water"); break;
     default:
-        Q_UNREACHABLE();
+        str = QLatin1String("Material::") + customMaterial(material).name;
         break;
     }
     return str;
@@ -59,6 +122,11 @@ Material toMaterial(const QString &name)
     else if ( name == QLatin1String("steam"  ) ) { return Material::Steam  ; }
     else if ( name == QLatin1String("water"  ) ) { return Material::Water  ; }
     else {
+        for (int i = 0; i < customMaterials().count(); ++i) {
+            if (customMaterials().at(i).name == name) {
+                return (Material)((int)Material::Water + 1 + i);
+            }
+        }
         Q_UNREACHABLE();
     }
     return Material::Water;
@@ -78,12 +146,58 @@ QString materialColor(const Material material, const ColorVariation color)
     case Material::Steam:  return (color==ColorVariation::Color0) ? QLatin1String("#bbd") : QLatin1String("#ccc"); break;
     case Material::Water:  return (color==ColorVariation::Color0) ? QLatin1String("#12d") : QLatin1String("#12f"); break;
     default:
-        Q_UNREACHABLE();
+        return (color==ColorVariation::Color0) ? customMaterial(material).color0 : customMaterial(material).color1;
         break;
     }
     return QLatin1String("#f00");
 }
 
+static QVector<QRgb> buildPalette()
+{
+    QVector<QRgb> palette(2 * materialCount());
+    for (int i = 0; i < materialCount(); ++i) {
+        const Material material = (Material)i;
+        palette[2*i]   = QColor(materialColor(material, ColorVariation::Color0)).rgba();
+        palette[2*i+1] = QColor(materialColor(material, ColorVariation::Color1)).rgba();
+    }
+    /* Air is not drawn */
+    palette[2*(int)Material::Air]   = qRgba(0, 0, 0, 0);
+    palette[2*(int)Material::Air+1] = qRgba(0, 0, 0, 0);
+    return palette;
+}
+
+/*!
+ * \brief Return the lookup table of the materials' colors.
+ *
+ * The color of a dot is at the index (2 * material + colorVariation).
+ * Colors are either opaque or fully transparent (for Air),
+ * so they are valid both as ARGB32 and ARGB32_Premultiplied pixels.
+ */
+static QVector<QRgb>& paletteTable()
+{
+    static QVector<QRgb> palette = buildPalette();
+    return palette;
+}
+
+static void rebuildPalette()
+{
+    paletteTable() = buildPalette();
+}
+
+const QRgb* materialPalette()
+{
+    return paletteTable().constData();
+}
+
+/*!
+ * \brief Return the materials' colors as a color table for indexed images.
+ * \sa materialPalette()
+ */
+QVector<QRgb> materialColorTable()
+{
+    return paletteTable();
+}
+
 static inline double materialRandomBreakValue(const Material material)
 {
     switch (material) {
@@ -98,7 +212,7 @@ static inline double materialRandomBreakValue(const Material material)
     case Material::Steam:  return 0.5; break;
     case Material::Water:  return 0.5; break;
     default:
-        Q_UNREACHABLE();
+        return customMaterial(material).colorBreak;
         break;
     }
     return 0.0;
@@ -106,18 +220,47 @@ static inline double materialRandomBreakValue(const Material material)
 
 ColorVariation computeRandomColor(const Material material)
 {
-    return (myrandom() < materialRandomBreakValue(material) )
+    return computeColor(material, myrandom());
+}
+
+/*!
+ * \brief Return the color variation of the \a material for the given
+ * \a random value between 0 and 1, e.g. from a seeded noise.
+ */
+ColorVariation computeColor(const Material material, const double random)
+{
+    return (random < materialRandomBreakValue(material) )
             ? ColorVariation::Color0
             : ColorVariation::Color1;
 }
 
+/*!
+ * \brief Return the color variation of the \a material at the position,
+ * from a hash of the position, the material and the \a salt.
+ *
+ * Unlike computeRandomColor(), it doesn't draw any random value:
+ * the same arguments always give the same color.
+ */
+ColorVariation computeHashedColor(const Material material, const int x, const int y,
+                                  const uint salt)
+{
+    const quint32 h = positionHash(salt ^ ((uint)material * 0x9e3779b9U), x, y);
+    return computeColor(material, h / 4294967296.0);
+}
+
 bool isSolid(const Material material)
 {
+    if (material > Material::Water) {
+        return customMaterial(material).solid;
+    }
     return (material==Material::Earth || material==Material::Plasma || material==Material::Rock);
 }
 
 bool isLiquid(const Material material)
 {
+    if (material > Material::Water) {
+        return customMaterial(material).liquid;
+    }
     return (material==Material::Acid || material==Material::Oil || material==Material::Water);
 }
 
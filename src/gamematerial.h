@@ -27,6 +27,8 @@
 
 #include <QtCore/QMetaType>
 #include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtGui/qrgb.h>
 
 #ifdef QT_DEBUG
 #  include <QtCore/QDebug>
@@ -53,11 +55,23 @@ enum class Material {
 
 Q_DECLARE_METATYPE(Material)
 
+/* A dot is stored as (2 * material + color) in a byte */
+#define C_MAX_MATERIAL_COUNT 128
+
+int materialCount();
+Material registerMaterial(const QString &name, const QString &color0, const QString &color1,
+                          const double colorBreak, const bool solid, const bool liquid);
+
 QString toString(const Material material);
 Material toMaterial(const QString &name);
 
 QString materialColor(const Material material, const ColorVariation color);
+const QRgb* materialPalette();
+QVector<QRgb> materialColorTable();
 ColorVariation computeRandomColor(const Material material);
+ColorVariation computeColor(const Material material, const double random);
+ColorVariation computeHashedColor(const Material material, const int x, const int y,
+                                  const uint salt);
 
 bool isSolid(const Material material);
 bool isLiquid(const Material material);
@@ -0,0 +1,229 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamematerialrules.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonParseError>
+#include <QtGui/QColor>
+
+/*! \class GameMaterialRules
+ *  \brief The class GameMaterialRules holds the material rules loaded from a file.
+ *
+ * The definition file is a JSON document, that can define new materials,
+ * and replace the rules of the built-in ones:
+ *
+ * \code
+ * {
+ *   "materials": [
+ *     {
+ *       "name": "lava",
+ *       "colors": [ "#f40", "#d20" ],
+ *       "colorBreak": 0.5,
+ *       "liquid": true,
+ *       "rules": [
+ *         { "neighbour": [0, 1], "requires": "air", "probability": 0.8,
+ *           "result": [ "air", "lava" ] },
+ *         { "neighbour": [0, 1], "requires": "water", "result": [ "rock", "steam" ] },
+ *         { "neighbour": [1, 0], "requires": "air", "probability": 0.1,
+ *           "fallthrough": true, "result": [ "air", "lava" ] }
+ *       ]
+ *     }
+ *   ]
+ * }
+ * \endcode
+ *
+ * For each dot, the rules of its material are tried in order,
+ * until the first one whose neighbour matches. "requires" is a material name,
+ * "!name" for any material but this one, or "*" for any material.
+ * "result" gives the new materials of the dot and of the neighbour,
+ * null to keep the current one.
+ * By default a matching rule stops the search, even if its probability fails.
+ * With "fallthrough", the next rules are tried when the probability fails.
+ *
+ * A built-in material with rules in the file uses them instead of
+ * its hard-coded behaviour.
+ *
+ * At load time, the names are resolved and the rules of all the materials
+ * are compiled in a single flat table, so that the step only walks
+ * an array of plain structs: no string lookup, no virtual call.
+ *
+ * \sa GameEngine::updateGame()
+ */
+
+QVector<MaterialRule> GameMaterialRules::s_rules;
+QVector<int> GameMaterialRules::s_first;
+
+
+static bool fail(QString *errorString, const QString &message)
+{
+    if (errorString) {
+        *errorString = message;
+    }
+    return false;
+}
+
+static QHash<QString, int> materialNames()
+{
+    QHash<QString, int> names;
+    for (int i = 0; i < materialCount(); ++i) {
+        const QString name = toString((Material)i).section(QLatin1String("::"), 1).toLower();
+        names.insert(name, i);
+    }
+    return names;
+}
+
+/* Resolve a material name of a result: null keeps the current material */
+static bool parseResult(const QJsonValue &value, const QHash<QString, int> &names, uchar *material)
+{
+    if (value.isNull()) {
+        *material = MaterialRule::KeepMaterial;
+        return true;
+    }
+    const QString name = value.toString().toLower();
+    if (!names.contains(name)) {
+        return false;
+    }
+    *material = (uchar)names.value(name);
+    return true;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Load the material definitions from the given \a fileName.
+ *
+ * It must be called at startup, before any world is created,
+ * because it can add new materials.
+ * Return false and set \a errorString on error.
+ */
+bool GameMaterialRules::load(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(errorString, file.errorString());
+    }
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        return fail(errorString, parseError.errorString());
+    }
+    const QJsonArray materials = document.object().value(QLatin1String("materials")).toArray();
+
+    /* First pass: register the new materials, so that the rules can refer to them */
+    QHash<QString, int> names = materialNames();
+    foreach (const QJsonValue &value, materials) {
+        const QJsonObject object = value.toObject();
+        const QString name = object.value(QLatin1String("name")).toString().toLower();
+        if (name.isEmpty()) {
+            return fail(errorString, QLatin1String("A material has no name."));
+        }
+        if (names.contains(name)) {
+            continue;
+        }
+        const QJsonArray colors = object.value(QLatin1String("colors")).toArray();
+        const QString color0 = colors.at(0).toString();
+        const QString color1 = colors.count() > 1 ? colors.at(1).toString() : color0;
+        if (!QColor(color0).isValid() || !QColor(color1).isValid()) {
+            return fail(errorString, QString("Invalid colors for '%0'.").arg(name));
+        }
+        const Material material = registerMaterial(
+                    name, color0, color1,
+                    object.value(QLatin1String("colorBreak")).toDouble(0.5),
+                    object.value(QLatin1String("solid")).toBool(false),
+                    object.value(QLatin1String("liquid")).toBool(false));
+        if (material == Material::Air) {
+            return fail(errorString, QLatin1String("Too many materials."));
+        }
+        names.insert(name, (int)material);
+    }
+
+    /* Second pass: compile the rules */
+    QVector<QVector<MaterialRule> > rulesPerMaterial(materialCount());
+    foreach (const QJsonValue &value, materials) {
+        const QJsonObject object = value.toObject();
+        const QString name = object.value(QLatin1String("name")).toString().toLower();
+        const int material = names.value(name);
+
+        foreach (const QJsonValue &ruleValue, object.value(QLatin1String("rules")).toArray()) {
+            const QJsonObject r = ruleValue.toObject();
+            MaterialRule rule;
+
+            const QJsonArray neighbour = r.value(QLatin1String("neighbour")).toArray();
+            rule.dx = (qint8)neighbour.at(0).toInt();
+            rule.dy = (qint8)neighbour.at(1).toInt();
+
+            QString required = r.value(QLatin1String("requires")).toString(QLatin1String("*")).toLower();
+            rule.negated = required.startsWith(QLatin1Char('!'));
+            if (rule.negated) {
+                required.remove(0, 1);
+            }
+            if (required == QLatin1String("*")) {
+                rule.required = MaterialRule::AnyMaterial;
+            } else if (names.contains(required)) {
+                rule.required = (uchar)names.value(required);
+            } else {
+                return fail(errorString, QString("Unknown material '%0' in the rules of '%1'.")
+                            .arg(required).arg(name));
+            }
+
+            rule.probability = (float)r.value(QLatin1String("probability")).toDouble(1.0);
+            rule.fallthrough = r.value(QLatin1String("fallthrough")).toBool(false);
+
+            const QJsonArray result = r.value(QLatin1String("result")).toArray();
+            if (result.count() != 2
+                    || !parseResult(result.at(0), names, &rule.self)
+                    || !parseResult(result.at(1), names, &rule.target)) {
+                return fail(errorString, QString("Invalid result in the rules of '%0'.").arg(name));
+            }
+            rulesPerMaterial[material] << rule;
+        }
+    }
+
+    /* Flatten */
+    s_rules.clear();
+    s_first.clear();
+    for (int i = 0; i < rulesPerMaterial.count(); ++i) {
+        s_first << s_rules.count();
+        s_rules << rulesPerMaterial.at(i);
+    }
+    s_first << s_rules.count();
+    return true;
+}
+
+/*!
+ * \brief Return the largest number of rows between a dot and the neighbour of its rules.
+ */
+int GameMaterialRules::maxReach()
+{
+    int reach = 0;
+    foreach (const MaterialRule &rule, s_rules) {
+        reach = qMax(reach, qAbs((int)rule.dy));
+    }
+    return reach;
+}
@@ -0,0 +1,84 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_MATERIAL_RULES_H
+#define GAME_MATERIAL_RULES_H
+
+#include "gamematerial.h"
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/*
+ * An interaction rule, compiled from the definition file.
+ *
+ * If the neighbour at (x+dx, y+dy) matches the required material,
+ * then with the given probability, the dot becomes 'self'
+ * and the neighbour becomes 'target'.
+ */
+struct MaterialRule
+{
+    enum { AnyMaterial = 0xFF, KeepMaterial = 0xFF };
+
+    qint8 dx;
+    qint8 dy;
+    uchar required;     /* material, or AnyMaterial */
+    bool negated;       /* the neighbour must NOT be the required material */
+    float probability;
+    uchar self;         /* new material of the dot, or KeepMaterial */
+    uchar target;       /* new material of the neighbour, or KeepMaterial */
+    bool fallthrough;   /* when the probability fails, try the next rule */
+};
+
+class GameMaterialRules
+{
+public:
+    static bool load(const QString &fileName, QString *errorString = Q_NULLPTR);
+
+    static inline const MaterialRule* begin(const Material material);
+    static inline const MaterialRule* end(const Material material);
+
+    static int maxReach();
+
+private:
+    /* The rules of all the materials, in a single flat table */
+    static QVector<MaterialRule> s_rules;
+
+    /* The rules of the material m are in [s_first[m], s_first[m+1]) */
+    static QVector<int> s_first;
+};
+
+inline const MaterialRule* GameMaterialRules::begin(const Material material)
+{
+    return s_first.isEmpty() ? Q_NULLPTR
+                             : s_rules.constData() + s_first.at((int)material);
+}
+
+inline const MaterialRule* GameMaterialRules::end(const Material material)
+{
+    return s_first.isEmpty() ? Q_NULLPTR
+                             : s_rules.constData() + s_first.at((int)material + 1);
+}
+
+#endif // GAME_MATERIAL_RULES_H
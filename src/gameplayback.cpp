@@ -0,0 +1,312 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameplayback.h"
+#include "gamedeltacodec.h"
+#include "gamerecording.h"
+#include "gameworld.h"
+#include "gametracer.h"
+
+#include <QtCore/QDataStream>
+
+#include <algorithm>
+
+/*! \class GamePlayback
+ *  \brief The class GamePlayback reads a recording of GameRecorder.
+ *
+ * seek() gives the world of any tick: it loads the last keyframe up to
+ * this tick, found in the index, then applies the following deltas up to
+ * the tick, that is less than the keyframe interval of the recording.
+ * next() then applies the records one by one.
+ *
+ * See gamerecording.h for the format of the file.
+ */
+
+GamePlayback::GamePlayback(const QString &fileName)
+  : m_fileName(fileName)
+  , m_file(fileName)
+  , m_keyframeInterval(0)
+  , m_lastTick(0)
+  , m_end(0)
+  , m_tick(0)
+  , m_isPositioned(false)
+{
+}
+
+GamePlayback::~GamePlayback()
+{
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GamePlayback::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = QString("Can't open '%0': %1")
+                .arg(m_fileName).arg(m_file.errorString());
+        return false;
+    }
+    QDataStream in(&m_file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 interval = 0;
+    in >> magic >> version >> interval;
+    if (in.status() != QDataStream::Ok || magic != C_RECORDING_MAGIC) {
+        m_errorString = QString("'%0' isn't a recording.").arg(m_fileName);
+        return false;
+    }
+    if (version != C_RECORDING_VERSION) {
+        m_errorString = QString("Unsupported version %0 of the recording '%1'.")
+                .arg(version).arg(m_fileName);
+        return false;
+    }
+    m_keyframeInterval = (int)interval;
+
+    if (!readIndex() && !scanRecords()) {
+        return false;
+    }
+    if (m_keyframeTicks.isEmpty()) {
+        m_errorString = QString("The recording '%0' is empty.").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
+
+QString GamePlayback::errorString() const
+{
+    return m_errorString;
+}
+
+int GamePlayback::keyframeInterval() const
+{
+    return m_keyframeInterval;
+}
+
+int GamePlayback::keyframeCount() const
+{
+    return m_keyframeTicks.count();
+}
+
+quint64 GamePlayback::firstTick() const
+{
+    return m_keyframeTicks.isEmpty() ? 0 : m_keyframeTicks.first();
+}
+
+quint64 GamePlayback::lastTick() const
+{
+    return m_lastTick;
+}
+
+/*!
+ * \brief Return the tick of the world given by the last seek() or next().
+ */
+quint64 GamePlayback::tick() const
+{
+    return m_tick;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Set the \a world to its state at the given \a tick.
+ *
+ * Before the first record, it's the world of the first record.
+ * Return false if the records can't be read.
+ */
+bool GamePlayback::seek(const quint64 tick, GameWorld *world)
+{
+    TRACE_SCOPE("GamePlayback::seek");
+
+    /* The last keyframe up to the tick */
+    const int i = qMax(0, (int)(std::upper_bound(m_keyframeTicks.constBegin(),
+                                                 m_keyframeTicks.constEnd(), tick)
+                                - m_keyframeTicks.constBegin()) - 1);
+    m_isPositioned = false;
+    Record record;
+    if (!m_file.seek(m_keyframeOffsets.at(i)) || !readRecord(&record)
+            || record.type != (quint8)RecordType::Keyframe || !apply(record, world)) {
+        return false;
+    }
+    m_isPositioned = true;
+
+    /* The deltas up to the tick */
+    while (m_file.pos() < m_end) {
+        const qint64 pos = m_file.pos();
+        if (!readRecordHeader(&record)) {
+            return false;
+        }
+        if (record.tick > tick) {
+            m_file.seek(pos);
+            break;
+        }
+        m_file.seek(pos);
+        if (!next(world)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Apply the next record to the \a world, positioned by seek().
+ *
+ * Return false at the end of the recording.
+ */
+bool GamePlayback::next(GameWorld *world)
+{
+    if (!m_isPositioned || m_file.pos() >= m_end) {
+        return false;
+    }
+    Record record;
+    if (!readRecord(&record) || !apply(record, world)) {
+        m_isPositioned = false;
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GamePlayback::readIndex()
+{
+    const qint64 size = m_file.size();
+    if (size < C_RECORDING_HEADER_SIZE + C_RECORDING_TRAILER_SIZE) {
+        return false;
+    }
+    m_file.seek(size - C_RECORDING_TRAILER_SIZE);
+    QDataStream in(&m_file);
+    quint64 lastTick = 0;
+    quint64 indexOffset = 0;
+    quint32 magic = 0;
+    in >> lastTick >> indexOffset >> magic;
+    if (in.status() != QDataStream::Ok || magic != C_RECORDING_INDEX_MAGIC
+            || indexOffset < C_RECORDING_HEADER_SIZE
+            || indexOffset > (quint64)(size - C_RECORDING_TRAILER_SIZE)) {
+        return false;
+    }
+
+    m_file.seek((qint64)indexOffset);
+    quint32 count = 0;
+    in >> count;
+    QVector<quint64> ticks;
+    QVector<qint64> offsets;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        quint64 tick = 0;
+        quint64 offset = 0;
+        in >> tick >> offset;
+        ticks << tick;
+        offsets << (qint64)offset;
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+    m_keyframeTicks = ticks;
+    m_keyframeOffsets = offsets;
+    m_lastTick = lastTick;
+    m_end = (qint64)indexOffset;
+    return true;
+}
+
+/*
+ * Rebuild the index from the records, up to the last complete one.
+ */
+bool GamePlayback::scanRecords()
+{
+    m_keyframeTicks.clear();
+    m_keyframeOffsets.clear();
+    m_lastTick = 0;
+
+    qint64 pos = C_RECORDING_HEADER_SIZE;
+    Record record;
+    while (m_file.seek(pos) && readRecordHeader(&record)) {
+        const qint64 next = pos + C_RECORDING_RECORD_HEADER_SIZE + record.dataSize;
+        if (record.type == (quint8)RecordType::Keyframe) {
+            m_keyframeTicks << record.tick;
+            m_keyframeOffsets << pos;
+        }
+        m_lastTick = record.tick;
+        pos = next;
+    }
+    m_end = pos;
+    return true;
+}
+
+/*
+ * Read the header of the record at the current position, without its data.
+ */
+bool GamePlayback::readRecordHeader(Record *record)
+{
+    QDataStream in(&m_file);
+    quint16 width = 0;
+    quint16 height = 0;
+    quint32 size = 0;
+    in >> record->type >> record->tick >> width >> height >> size;
+    if (in.status() != QDataStream::Ok
+            || (record->type != (quint8)RecordType::Keyframe
+                && record->type != (quint8)RecordType::Delta)) {
+        m_errorString = QString("Invalid record in '%0'.").arg(m_fileName);
+        return false;
+    }
+    if (size > (quint64)(m_file.size() - m_file.pos())) {
+        m_errorString = QString("Truncated record in '%0'.").arg(m_fileName);
+        return false;
+    }
+    record->size = QSize(width, height);
+    record->dataSize = size;
+    return true;
+}
+
+bool GamePlayback::readRecord(Record *record)
+{
+    if (!readRecordHeader(record)) {
+        return false;
+    }
+    record->data = m_file.read(record->dataSize);
+    if (record->data.size() != (int)record->dataSize) {
+        m_errorString = QString("Truncated record in '%0'.").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
+
+bool GamePlayback::apply(const Record &record, GameWorld *world)
+{
+    TRACE_SCOPE("GamePlayback::apply");
+
+    if (record.type == (quint8)RecordType::Keyframe) {
+        if (world->width() != record.size.width() || world->height() != record.size.height()) {
+            world->setSize(record.size.width(), record.size.height());
+        }
+    } else if (world->width() != record.size.width() || world->height() != record.size.height()) {
+        m_errorString = QString("Invalid delta in '%0'.").arg(m_fileName);
+        return false;
+    }
+    const QByteArray cells = qUncompress(record.data);
+    if (!GameDeltaCodec::decode(cells, world)) {
+        m_errorString = QString("Invalid record in '%0'.").arg(m_fileName);
+        return false;
+    }
+    m_tick = record.tick;
+    return true;
+}
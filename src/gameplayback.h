@@ -0,0 +1,81 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_PLAYBACK_H
+#define GAME_PLAYBACK_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class GameWorld;
+class GamePlayback
+{
+public:
+    explicit GamePlayback(const QString &fileName);
+    ~GamePlayback();
+
+    bool open();
+    QString errorString() const;
+
+    int keyframeInterval() const;
+    int keyframeCount() const;
+    quint64 firstTick() const;
+    quint64 lastTick() const;
+
+    bool seek(const quint64 tick, GameWorld *world);
+    bool next(GameWorld *world);
+    quint64 tick() const;
+
+private:
+    struct Record
+    {
+        quint8 type;
+        quint64 tick;
+        QSize size;
+        quint32 dataSize;
+        QByteArray data;
+    };
+
+    QString m_fileName;
+    QFile m_file;
+    QString m_errorString;
+    int m_keyframeInterval;
+    QVector<quint64> m_keyframeTicks;
+    QVector<qint64> m_keyframeOffsets;
+    quint64 m_lastTick;
+    qint64 m_end;           /* end of the records */
+    quint64 m_tick;         /* of the last applied record */
+    bool m_isPositioned;    /* the world is the one of m_tick */
+
+    bool readIndex();
+    bool scanRecords();
+    bool readRecordHeader(Record *record);
+    bool readRecord(Record *record);
+    bool apply(const Record &record, GameWorld *world);
+};
+
+#endif // GAME_PLAYBACK_H
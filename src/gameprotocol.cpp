@@ -0,0 +1,95 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameprotocol.h"
+
+#include <QtCore/QString>
+
+#define C_MAX_MESSAGE_SIZE (64 * 1024 * 1024)
+
+/*! \class GameProtocol
+ *  \brief The class GameProtocol frames the messages between
+ *  a GameServer and its GameClient, and between the GameStrip processes.
+ *
+ * A message is its size on 32 bits (little-endian), its type on 8 bits,
+ * then its payload. The size counts the type and the payload.
+ *
+ * The address of a server is either "host:port" for TCP,
+ * e.g. "127.0.0.1:5555", or the name of a local socket,
+ * e.g. "elementdots" (a Unix socket on Unix).
+ */
+
+QByteArray GameProtocol::message(const MessageType type, const QByteArray &payload)
+{
+    const quint32 size = 1 + payload.size();
+    QByteArray data;
+    data.reserve(4 + size);
+    data.append((char)(size & 0xFF));
+    data.append((char)((size >> 8) & 0xFF));
+    data.append((char)((size >> 16) & 0xFF));
+    data.append((char)((size >> 24) & 0xFF));
+    data.append((char)type);
+    data.append(payload);
+    return data;
+}
+
+/*!
+ * \brief Take the first message of the received \a buffer.
+ *
+ * Return MessageIncomplete if the buffer doesn't contain a whole message yet.
+ */
+GameProtocol::ReadStatus GameProtocol::readMessage(QByteArray &buffer, MessageType *type,
+                                                   QByteArray *payload)
+{
+    if (buffer.size() < 4) {
+        return MessageIncomplete;
+    }
+    const uchar *p = (const uchar*)buffer.constData();
+    const quint32 size = p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+    if (size == 0 || size > C_MAX_MESSAGE_SIZE) {
+        return MessageInvalid;
+    }
+    if ((quint32)buffer.size() < 4 + size) {
+        return MessageIncomplete;
+    }
+    *type = (MessageType)p[4];
+    *payload = buffer.mid(5, size - 1);
+    buffer.remove(0, 4 + size);
+    return MessageRead;
+}
+
+/*!
+ * \brief Return true if the \a address is "host:port".
+ */
+bool GameProtocol::isTcpAddress(const QString &address, QString *host, quint16 *port)
+{
+    const int colon = address.lastIndexOf(QLatin1Char(':'));
+    if (colon < 0) {
+        return false;
+    }
+    bool ok = false;
+    *port = address.mid(colon + 1).toUShort(&ok);
+    *host = address.left(colon);
+    return ok;
+}
@@ -0,0 +1,60 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_PROTOCOL_H
+#define GAME_PROTOCOL_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+class GameProtocol
+{
+public:
+    enum MessageType {
+        HelloMessage           =  1,  /* server: width, height, material count */
+        KeyframeMessage        =  2,  /* server: tick, cells of the whole world */
+        DeltaMessage           =  3,  /* server: tick, cells of the dirty rects */
+        BrushMessage           = 16,  /* client: pressed, x, y (32-bit), material */
+        KeyframeRequestMessage = 17,  /* client: ask for a keyframe */
+        ClearMessage           = 18,  /* client: clear the world */
+        FillRandomlyMessage    = 19,  /* client: fill the world randomly */
+        ResizeMessage          = 20,  /* client: width, height */
+        HaloMessage            = 32,  /* strip: cells of the rows seen by the neighbour */
+        WritesMessage          = 33,  /* strip: dots written into the neighbour's rows */
+        RejectsMessage         = 34   /* strip: moves of the neighbour not applied */
+    };
+
+    enum ReadStatus {
+        MessageIncomplete,
+        MessageRead,
+        MessageInvalid
+    };
+
+    static QByteArray message(const MessageType type, const QByteArray &payload = QByteArray());
+    static ReadStatus readMessage(QByteArray &buffer, MessageType *type, QByteArray *payload);
+
+    static bool isTcpAddress(const QString &address, QString *host, quint16 *port);
+};
+
+#endif // GAME_PROTOCOL_H
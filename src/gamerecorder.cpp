@@ -0,0 +1,215 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamerecorder.h"
+#include "gamedeltacodec.h"
+#include "gamerecording.h"
+#include "gameworld.h"
+#include "gametracer.h"
+
+#include <QtCore/QDataStream>
+#include <QtConcurrent/QtConcurrent>
+
+/*! \class GameRecorder
+ *  \brief The class GameRecorder writes a recording of the steps, that
+ *  GamePlayback can seek into.
+ *
+ * See gamerecording.h for the format of the file.
+ *
+ * record() only encodes the modified dots, with GameDeltaCodec, or the
+ * whole world for a keyframe. The records are compressed and written by
+ * a background thread, in order, so that the file doesn't slow down the
+ * simulation. The queue is bounded: when \a maxPendingRecords records are
+ * being written, record() waits for the oldest one.
+ *
+ * A step that modified nothing isn't recorded: the world of a tick is the
+ * one of the last record up to this tick.
+ *
+ * \sa GameEngine::startRecording()
+ */
+
+struct PendingRecord
+{
+    RecordType type;
+    quint64 tick;
+    QSize size;
+    QByteArray cells;   /* GameDeltaCodec data, not compressed yet */
+};
+
+/*
+ * Compress and write a record. Called on the writer thread.
+ */
+static bool writeRecord(QFile *file, QVector<GameRecorder::IndexEntry> *index,
+                        const PendingRecord &record)
+{
+    TRACE_SCOPE("GameRecorder::writeRecord");
+
+    const QByteArray data = qCompress(record.cells);
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << (quint8)record.type << record.tick
+        << (quint16)record.size.width() << (quint16)record.size.height()
+        << (quint32)data.size();
+    bytes += data;
+
+    if (record.type == RecordType::Keyframe) {
+        *index << GameRecorder::IndexEntry{record.tick, (quint64)file->pos()};
+    }
+    return file->write(bytes) == bytes.size();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameRecorder::GameRecorder(const QString &fileName, const int keyframeInterval,
+                           const int maxPendingRecords)
+  : m_fileName(fileName)
+  , m_keyframeInterval(qMax(1, keyframeInterval))
+  , m_maxPendingRecords(qMax(1, maxPendingRecords))
+  , m_recordCount(0)
+  , m_sinceKeyframe(0)
+  , m_lastTick(0)
+  , m_file(fileName)
+{
+    m_writer.setMaxThreadCount(1);
+}
+
+GameRecorder::~GameRecorder()
+{
+    finish();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameRecorder::open()
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = QString("Can't create '%0': %1")
+                .arg(m_fileName).arg(m_file.errorString());
+        return false;
+    }
+    QDataStream out(&m_file);
+    out << (quint32)C_RECORDING_MAGIC << (quint32)C_RECORDING_VERSION
+        << (quint32)m_keyframeInterval;
+    if (out.status() != QDataStream::Ok) {
+        m_errorString = QString("Can't write '%0'.").arg(m_fileName);
+        return false;
+    }
+    return true;
+}
+
+QString GameRecorder::errorString() const
+{
+    return m_errorString;
+}
+
+int GameRecorder::recordCount() const
+{
+    return m_recordCount;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Record the dots of the \a world in the given \a rects, modified
+ * since the previous record, as the state of the \a tick.
+ *
+ * Return false if a previous record couldn't be written.
+ */
+bool GameRecorder::record(const GameWorld *world, const QVector<QRect> &rects,
+                          const quint64 tick)
+{
+    TRACE_SCOPE("GameRecorder::record");
+
+    const QSize size(world->width(), world->height());
+    if (size.width() > GameDeltaCodec::maxWorldSize()
+            || size.height() > GameDeltaCodec::maxWorldSize()) {
+        m_errorString = QString("The world can't be larger than %0x%0 dots.")
+                .arg(GameDeltaCodec::maxWorldSize());
+        return false;
+    }
+    const bool keyframe = (m_recordCount == 0 || size != m_size
+                           || m_sinceKeyframe + 1 >= m_keyframeInterval);
+    if (!keyframe && rects.isEmpty()) {
+        return true;
+    }
+
+    /* Bounded queue: wait for the oldest record */
+    while (m_pending.count() >= m_maxPendingRecords) {
+        if (!waitOldest())
+            return false;
+    }
+
+    PendingRecord pending;
+    pending.type = keyframe ? RecordType::Keyframe : RecordType::Delta;
+    pending.tick = tick;
+    pending.size = size;
+    pending.cells = keyframe
+            ? GameDeltaCodec::encodeKeyframe(world)
+            : GameDeltaCodec::encode(world, rects);
+    m_pending.enqueue(QtConcurrent::run(&m_writer, writeRecord, &m_file, &m_index, pending));
+    m_recordCount++;
+    m_sinceKeyframe = keyframe ? 0 : m_sinceKeyframe + 1;
+    m_size = size;
+    m_lastTick = tick;
+    return true;
+}
+
+/*!
+ * \brief Wait for all the pending records, then write the index.
+ */
+bool GameRecorder::finish()
+{
+    bool ok = true;
+    while (!m_pending.isEmpty()) {
+        ok = waitOldest() && ok;
+    }
+    if (!m_file.isOpen()) {
+        return ok;
+    }
+
+    const quint64 indexOffset = (quint64)m_file.pos();
+    QDataStream out(&m_file);
+    out << (quint32)m_index.count();
+    foreach (const IndexEntry &entry, m_index) {
+        out << entry.tick << entry.offset;
+    }
+    out << m_lastTick << indexOffset << (quint32)C_RECORDING_INDEX_MAGIC;
+    if (out.status() != QDataStream::Ok) {
+        m_errorString = QString("Can't write the index of '%0'.").arg(m_fileName);
+        ok = false;
+    }
+    m_file.close();
+    return ok;
+}
+
+bool GameRecorder::waitOldest()
+{
+    QFuture<bool> future = m_pending.dequeue();
+    if (!future.result()) {
+        m_errorString = QString("Can't write '%0': %1")
+                .arg(m_fileName).arg(m_file.errorString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_RECORDER_H
+#define GAME_RECORDER_H
+
+#include <QtCore/QFile>
+#include <QtCore/QFuture>
+#include <QtCore/QQueue>
+#include <QtCore/QRect>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+class GameWorld;
+class GameRecorder
+{
+public:
+    struct IndexEntry
+    {
+        quint64 tick;
+        quint64 offset;
+    };
+
+    explicit GameRecorder(const QString &fileName, const int keyframeInterval,
+                          const int maxPendingRecords = 8);
+    ~GameRecorder();
+
+    bool open();
+    QString errorString() const;
+
+    bool record(const GameWorld *world, const QVector<QRect> &rects, const quint64 tick);
+    bool finish();
+
+    int recordCount() const;
+
+private:
+    QString m_fileName;
+    int m_keyframeInterval;
+    int m_maxPendingRecords;
+    int m_recordCount;
+    int m_sinceKeyframe;    /* records since the last keyframe */
+    QSize m_size;           /* of the last record */
+    quint64 m_lastTick;
+    QString m_errorString;
+    QFile m_file;
+    QThreadPool m_writer;   /* one thread: the records are written in order */
+    QQueue<QFuture<bool> > m_pending;
+    QVector<IndexEntry> m_index;  /* filled by the writer thread */
+
+    bool waitOldest();
+};
+
+#endif // GAME_RECORDER_H
@@ -0,0 +1,66 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_RECORDING_H
+#define GAME_RECORDING_H
+
+#include <QtCore/QtGlobal>
+
+/*
+ * Layout of a recording file, see GameRecorder and GamePlayback.
+ * The numbers are written with QDataStream.
+ *
+ * The file starts with a header:
+ *   quint32 magic "ELDR", quint32 version, quint32 keyframe interval
+ *
+ * followed by the records, one per recorded step:
+ *   quint8 type, quint64 tick, quint16 width, quint16 height,
+ *   quint32 size, then 'size' bytes of qCompress()ed GameDeltaCodec data.
+ * A keyframe holds the whole world. A delta holds the dots modified since
+ * the previous record: it applies to the world of the previous record.
+ * A keyframe is recorded every 'keyframe interval' records, and when the
+ * size of the world changes.
+ *
+ * The file ends with the index of the keyframes and a trailer:
+ *   quint32 count, count x (quint64 tick, quint64 offset of the record),
+ *   quint64 last tick, quint64 offset of the index, quint32 magic "ELDI"
+ *
+ * Without the trailer, e.g. if the recorder was killed, the index is
+ * rebuilt from the records.
+ */
+
+#define C_RECORDING_MAGIC          0x454c4452  /* "ELDR" */
+#define C_RECORDING_INDEX_MAGIC    0x454c4449  /* "ELDI" */
+#define C_RECORDING_VERSION        1
+
+#define C_RECORDING_HEADER_SIZE         12
+#define C_RECORDING_RECORD_HEADER_SIZE  17
+#define C_RECORDING_TRAILER_SIZE        20
+
+enum class RecordType : quint8 {
+    Keyframe = 1,
+    Delta    = 2
+};
+
+#endif // GAME_RECORDING_H
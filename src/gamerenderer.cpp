@@ -24,6 +24,7 @@
 
 #include "gamerenderer.h"
 #include "gameworld.h"
+#include "gametracer.h"
 #include "utils.h"
 
 #include <QtGui/QPainter>
@@ -31,26 +32,51 @@
 
 /*! \class GameRenderer
  *  The class GameRenderer contains renderer Helper functions.
+ *
+ * The renderers only read the world: they can run concurrently.
  */
 
-void GameRenderer::paintGrid(GameRenderer::Tile &tile, const QColor &gridColor)
+/* One liquid dot in C_SHIMMER_RATE shimmers at each tick */
+#define C_SHIMMER_RATE  10
+
+/*
+ * Return the color variation of the dot to render the liquid effect:
+ * a liquid dot under the same liquid swaps its color with the dot above.
+ * The swapped pairs are a hash of the \a tick and the position,
+ * so that the world is never written.
+ */
+static inline ColorVariation shimmer(const GameWorld *world, const int x, const int y,
+                                     const Material mat, const ColorVariation c,
+                                     const quint64 tick)
 {
-    QPainter p(&tile.pixmap);
+    if (y > 0 && positionHash((uint)tick, x, y) % C_SHIMMER_RATE == 0
+            && world->dot(x, y-1) == mat) {
+        return world->colorVariation(x, y-1);
+    }
+    if (y < world->height() - 1 && positionHash((uint)tick, x, y+1) % C_SHIMMER_RATE == 0
+            && world->dot(x, y+1) == mat) {
+        return world->colorVariation(x, y+1);
+    }
+    return c;
+}
 
-    QSharedPointer<GameWorld> world = tile.world;
+void GameRenderer::paintGrid(GameRenderer::Tile &tile, const QColor &gridColor)
+{
+    QPainter p(&tile.image);
 
     QRect borders(0, 0, tile.totalSize.width()-1, tile.totalSize.height()-1);
     p.setPen(gridColor);
 
-    const qreal cellWidth = (qreal)tile.totalSize.width()/world->width();
-    const qreal cellHeight = (qreal)tile.totalSize.height()/world->height();
+    const QRectF &view = tile.view;
+    const qreal cellWidth = (qreal)tile.totalSize.width()/view.width();
+    const qreal cellHeight = (qreal)tile.totalSize.height()/view.height();
 
-    for (int x = world->width(); x >= 0; --x) {
-        const int left = qFloor(cellWidth * x);
+    for (int x = qCeil(view.right()); x >= qFloor(view.left()); --x) {
+        const int left = qFloor(cellWidth * (x - view.x()));
         p.drawLine(left, 0, left, tile.totalSize.height());
     }
-    for (int y = world->height(); y >= 0; --y) {
-        const int top  = qFloor(cellHeight * y);
+    for (int y = qCeil(view.bottom()); y >= qFloor(view.top()); --y) {
+        const int top  = qFloor(cellHeight * (y - view.y()));
         p.drawLine(0, top, tile.totalSize.width(), top);
     }
     p.drawRect(borders);
@@ -59,7 +85,9 @@ void GameRenderer::paintGrid(GameRenderer::Tile &tile, const QColor &gridColor)
 
 void GameRenderer::paintTile(GameRenderer::Tile &tile)
 {
-    QSharedPointer<GameWorld> world = tile.world;
+    TRACE_SCOPE("GameRenderer::paintTile");
+
+    QSharedPointer<const GameWorld> world = tile.world;
     Q_ASSERT( tile.x1 >=0 );
     Q_ASSERT( tile.y1 >=0 );
     Q_ASSERT( tile.x1 < tile.x2 );
@@ -67,32 +95,30 @@ void GameRenderer::paintTile(GameRenderer::Tile &tile)
     Q_ASSERT( tile.x2 <= world->width() );
     Q_ASSERT( tile.y2 <= world->height() );
 
-    QPainter p(&tile.pixmap);
+    /* The tile's image is reused from one frame to the next */
+    tile.image.fill(Qt::transparent);
 
-    const qreal cellWidth = (qreal)tile.totalSize.width()/world->width();
-    const qreal cellHeight = (qreal)tile.totalSize.height()/world->height();
+    QPainter p(&tile.image);
 
+    const QRectF &view = tile.view;
+    const qreal cellWidth = (qreal)tile.totalSize.width()/view.width();
+    const qreal cellHeight = (qreal)tile.totalSize.height()/view.height();
 
     for (int y = tile.y1; y < tile.y2; ++y) {
         for (int x = tile.x1; x < tile.x2; ++x) {
 
             const Material mat = world->dot(x,y);
-            const ColorVariation c = world->colorVariation(x,y);
+            ColorVariation c = world->colorVariation(x,y);
 
             /* Permute colors to rendering liquid effect */
-            const Material mat1 = world->dot(x,y-1);
-            const ColorVariation c1 = world->colorVariation(x,y-1);
-            if (isLiquid(mat) && mat == mat1 && myrandom()<0.1) {
-                if (c1 != c) {
-                    world->setColorVariation(x,y,c1);
-                    world->setColorVariation(x,y-1,c);
-                }
+            if (isLiquid(mat)) {
+                c = shimmer(world.data(), x, y, mat, c, tile.tick);
             }
 
             /* Draw the dot */
             if (mat != Material::Air) {
-                const int left = qFloor(cellWidth * (x - tile.x1));
-                const int top  = qFloor(cellHeight * (y - tile.y1));
+                const int left = qFloor(cellWidth * (x - view.x())) - tile.offset.x();
+                const int top  = qFloor(cellHeight * (y - view.y())) - tile.offset.y();
                 const QRect r(left, top, qCeil(cellWidth), qCeil(cellHeight));
 
                 const QColor color1 = materialColor(mat, c);
@@ -103,3 +129,67 @@ void GameRenderer::paintTile(GameRenderer::Tile &tile)
     return;
 }
 
+/*!
+ * \brief Paint the world in the given \a image, at one pixel per dot.
+ *
+ * The pixels are written directly in the scanlines, from the palette
+ * lookup table. Air is transparent.
+ * The image is then meant to be scaled to the widget with a single
+ * nearest-neighbour blit.
+ * The liquids shimmer with the given \a tick.
+ *
+ * \sa materialPalette()
+ */
+void GameRenderer::paintImage(const QSharedPointer<const GameWorld> &world, QImage &image,
+                              const quint64 tick)
+{
+    const int width = world->width();
+    const int height = world->height();
+    if (image.width() != width || image.height() != height
+            || image.format() != QImage::Format_ARGB32_Premultiplied) {
+        image = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+    }
+    paintImage(world, image, QRect(0, 0, width, height), tick);
+}
+
+/*!
+ * \brief Repaint only the dots of the given \a rect in the \a image.
+ *
+ * The \a image must have been painted once by paintImage() before.
+ * The liquids out of the \a rect keep the effect of their last repaint,
+ * so that a settled world costs nothing.
+ *
+ * \sa GameWorld::takeDirtyRects()
+ */
+void GameRenderer::paintImage(const QSharedPointer<const GameWorld> &world, QImage &image,
+                              const QRect &rect, const quint64 tick)
+{
+    TRACE_SCOPE("GameRenderer::paintImage");
+
+    Q_ASSERT(image.width() == world->width());
+    Q_ASSERT(image.height() == world->height());
+    Q_ASSERT(QRect(0, 0, world->width(), world->height()).contains(rect));
+
+    const QRgb *palette = materialPalette();
+
+    bool liquids[C_MAX_MATERIAL_COUNT];
+    for (int i = 0; i < C_MAX_MATERIAL_COUNT; ++i) {
+        liquids[i] = (i < materialCount()) && isLiquid((Material)i);
+    }
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar *cells = world->constScanLine(y);
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+
+            /* The cell is also the index of its color in the palette */
+            uchar cell = cells[x];
+            if (liquids[cell >> 1]) {
+                const Material mat = (Material)(cell >> 1);
+                const ColorVariation c = (ColorVariation)(cell & 1);
+                cell = (uchar)((cell & ~1) | (int)shimmer(world.data(), x, y, mat, c, tick));
+            }
+            line[x] = palette[cell];
+        }
+    }
+}
@@ -26,7 +26,8 @@
 #define GAME_RENDERER_H
 
 
-#include <QtGui/QPixmap>
+#include <QtGui/QImage>
+#include <QtCore/QSharedPointer>
 
 class GameWorld;
 class GameRenderer
@@ -34,11 +35,13 @@ class GameRenderer
 public:
     struct Tile
     {
-        QSharedPointer<GameWorld> world;
+        QSharedPointer<const GameWorld> world;
+        QRectF view; /* region of the world shown in totalSize, in dots */
         int x1,y1,x2,y2;
         QPoint offset;
-        QPixmap pixmap;
+        QImage image;
         QSize totalSize;
+        quint64 tick; /* of the liquid effect */
     };
 
     explicit GameRenderer() {}
@@ -46,6 +49,11 @@ public:
     static void paintGrid(Tile &tile, const QColor &gridColor);
     static void paintTile(Tile &tile);
 
+    static void paintImage(const QSharedPointer<const GameWorld> &world, QImage &image,
+                           const quint64 tick);
+    static void paintImage(const QSharedPointer<const GameWorld> &world, QImage &image,
+                           const QRect &rect, const quint64 tick);
+
 };
 
 #endif // GAME_RENDERER_H
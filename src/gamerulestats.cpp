@@ -0,0 +1,193 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamerulestats.h"
+
+#include <QtCore/QTextStream>
+
+/*! \class GameRuleStats
+ *  \brief The class GameRuleStats counts how often each rule branch fires.
+ *
+ * It also counts the random values drawn for each rule,
+ * using the draw counter of the current thread.
+ * Hence an instance must be used by only one thread at a time:
+ * the one that steps the world.
+ *
+ * \sa GameEngine::setRuleStatsEnabled()
+ */
+
+QString toString(const Rule rule)
+{
+    switch (rule) {
+    case Rule::AcidFall:              return QLatin1String("AcidFall");
+    case Rule::AcidBurnFire:          return QLatin1String("AcidBurnFire");
+    case Rule::AcidSinkWater:         return QLatin1String("AcidSinkWater");
+    case Rule::AcidDissolveOnSand:    return QLatin1String("AcidDissolveOnSand");
+    case Rule::AcidSpreadOnRock:      return QLatin1String("AcidSpreadOnRock");
+    case Rule::AcidEatBelow:          return QLatin1String("AcidEatBelow");
+    case Rule::AcidMoveRight:         return QLatin1String("AcidMoveRight");
+    case Rule::AcidMoveLeft:          return QLatin1String("AcidMoveLeft");
+    case Rule::AcidExplodeOil:        return QLatin1String("AcidExplodeOil");
+    case Rule::AcidSpread:            return QLatin1String("AcidSpread");
+    case Rule::AcidIdle:              return QLatin1String("AcidIdle");
+
+    case Rule::FireFall:              return QLatin1String("FireFall");
+    case Rule::FireDieUnderRock:      return QLatin1String("FireDieUnderRock");
+    case Rule::FireSpreadRightOnFuel: return QLatin1String("FireSpreadRightOnFuel");
+    case Rule::FireSpreadLeftOnFuel:  return QLatin1String("FireSpreadLeftOnFuel");
+    case Rule::FireBurnOil:           return QLatin1String("FireBurnOil");
+    case Rule::FireExplodeAcid:       return QLatin1String("FireExplodeAcid");
+    case Rule::FireDieOnRock:         return QLatin1String("FireDieOnRock");
+    case Rule::FireSpreadRight:       return QLatin1String("FireSpreadRight");
+    case Rule::FireSpreadLeft:        return QLatin1String("FireSpreadLeft");
+    case Rule::FireBurnEarth:         return QLatin1String("FireBurnEarth");
+    case Rule::FireRise:              return QLatin1String("FireRise");
+    case Rule::FireDieInPlume:        return QLatin1String("FireDieInPlume");
+    case Rule::FireIdle:              return QLatin1String("FireIdle");
+
+    case Rule::OilSinkFire:           return QLatin1String("OilSinkFire");
+    case Rule::OilFall:               return QLatin1String("OilFall");
+    case Rule::OilIgnite:             return QLatin1String("OilIgnite");
+    case Rule::OilDrip:               return QLatin1String("OilDrip");
+    case Rule::OilSpread:             return QLatin1String("OilSpread");
+    case Rule::OilIdle:               return QLatin1String("OilIdle");
+
+    case Rule::PlasmaDecay:           return QLatin1String("PlasmaDecay");
+    case Rule::PlasmaIdle:            return QLatin1String("PlasmaIdle");
+
+    case Rule::SandFall:              return QLatin1String("SandFall");
+    case Rule::SandSinkWater:         return QLatin1String("SandSinkWater");
+    case Rule::SandSinkAcid:          return QLatin1String("SandSinkAcid");
+    case Rule::SandSinkOil:           return QLatin1String("SandSinkOil");
+    case Rule::SandQuenchFire:        return QLatin1String("SandQuenchFire");
+    case Rule::SandSlideLeft:         return QLatin1String("SandSlideLeft");
+    case Rule::SandSlideRight:        return QLatin1String("SandSlideRight");
+    case Rule::SandToppleRight:       return QLatin1String("SandToppleRight");
+    case Rule::SandSwapWaterRight:    return QLatin1String("SandSwapWaterRight");
+    case Rule::SandSwapWaterLeft:     return QLatin1String("SandSwapWaterLeft");
+    case Rule::SandSwapOilRight:      return QLatin1String("SandSwapOilRight");
+    case Rule::SandSwapOilLeft:       return QLatin1String("SandSwapOilLeft");
+    case Rule::SandToppleLeft:        return QLatin1String("SandToppleLeft");
+    case Rule::SandIdle:              return QLatin1String("SandIdle");
+
+    case Rule::SteamRise:             return QLatin1String("SteamRise");
+    case Rule::SteamDriftLeft:        return QLatin1String("SteamDriftLeft");
+    case Rule::SteamDriftRight:       return QLatin1String("SteamDriftRight");
+    case Rule::SteamDriftFarRight:    return QLatin1String("SteamDriftFarRight");
+    case Rule::SteamDriftFarLeft:     return QLatin1String("SteamDriftFarLeft");
+    case Rule::SteamCondense:         return QLatin1String("SteamCondense");
+    case Rule::SteamIdle:             return QLatin1String("SteamIdle");
+
+    case Rule::WaterFall:             return QLatin1String("WaterFall");
+    case Rule::WaterBoil:             return QLatin1String("WaterBoil");
+    case Rule::WaterQuenchRight:      return QLatin1String("WaterQuenchRight");
+    case Rule::WaterQuenchLeft:       return QLatin1String("WaterQuenchLeft");
+    case Rule::WaterSinkOil:          return QLatin1String("WaterSinkOil");
+    case Rule::WaterDiluteAcid:       return QLatin1String("WaterDiluteAcid");
+    case Rule::WaterSwapOilRight:     return QLatin1String("WaterSwapOilRight");
+    case Rule::WaterSwapOilLeft:      return QLatin1String("WaterSwapOilLeft");
+    case Rule::WaterSpread:           return QLatin1String("WaterSpread");
+    case Rule::WaterIdle:             return QLatin1String("WaterIdle");
+    default:
+        Q_UNREACHABLE();
+        break;
+    }
+    return QString();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameRuleStats::GameRuleStats()
+{
+    clear();
+}
+
+void GameRuleStats::clear()
+{
+    memset(m_hits, 0, sizeof(m_hits));
+    memset(m_draws, 0, sizeof(m_draws));
+    m_steps = 0;
+    m_current = Rule::Count;
+    m_idle = false;
+    m_drawMark = randomDrawCount();
+}
+
+/*!
+ * \brief Attribute the pending draws and count one more step.
+ */
+void GameRuleStats::endStep()
+{
+    flush();
+    m_current = Rule::Count;
+    m_steps++;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+int GameRuleStats::steps() const
+{
+    return m_steps;
+}
+
+quint64 GameRuleStats::hits(const Rule rule) const
+{
+    return m_hits[(int)rule];
+}
+
+quint64 GameRuleStats::draws(const Rule rule) const
+{
+    return m_draws[(int)rule];
+}
+
+GameRuleStats &GameRuleStats::operator+=(const GameRuleStats &other)
+{
+    for (int i = 0; i < (int)Rule::Count; ++i) {
+        m_hits[i] += other.m_hits[i];
+        m_draws[i] += other.m_draws[i];
+    }
+    m_steps += other.m_steps;
+    return *this;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the counters as a CSV table, one rule per row.
+ */
+QString GameRuleStats::toCsv() const
+{
+    QString str;
+    QTextStream out(&str);
+    out << "rule,hits,hits_per_step,draws,draws_per_hit\n";
+    for (int i = 0; i < (int)Rule::Count; ++i) {
+        const quint64 hits = m_hits[i];
+        const quint64 draws = m_draws[i];
+        out << toString((Rule)i) << ','
+            << hits << ','
+            << QString::number(m_steps > 0 ? (double)hits / m_steps : 0.0, 'f', 2) << ','
+            << draws << ','
+            << QString::number(hits > 0 ? (double)draws / hits : 0.0, 'f', 2) << '\n';
+    }
+    return str;
+}
@@ -0,0 +1,183 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_RULE_STATS_H
+#define GAME_RULE_STATS_H
+
+#include "utils.h"
+
+#include <QtCore/QString>
+
+/*
+ * The rule branches of GameEngine::updateGame().
+ * The "Idle" rules count the dots for which no branch fired.
+ */
+enum class Rule {
+    AcidFall = 0,
+    AcidBurnFire,
+    AcidSinkWater,
+    AcidDissolveOnSand,
+    AcidSpreadOnRock,
+    AcidEatBelow,
+    AcidMoveRight,
+    AcidMoveLeft,
+    AcidExplodeOil,
+    AcidSpread,
+    AcidIdle,
+
+    FireFall,
+    FireDieUnderRock,
+    FireSpreadRightOnFuel,
+    FireSpreadLeftOnFuel,
+    FireBurnOil,
+    FireExplodeAcid,
+    FireDieOnRock,
+    FireSpreadRight,
+    FireSpreadLeft,
+    FireBurnEarth,
+    FireRise,
+    FireDieInPlume,
+    FireIdle,
+
+    OilSinkFire,
+    OilFall,
+    OilIgnite,
+    OilDrip,
+    OilSpread,
+    OilIdle,
+
+    PlasmaDecay,
+    PlasmaIdle,
+
+    SandFall,
+    SandSinkWater,
+    SandSinkAcid,
+    SandSinkOil,
+    SandQuenchFire,
+    SandSlideLeft,
+    SandSlideRight,
+    SandToppleRight,
+    SandSwapWaterRight,
+    SandSwapWaterLeft,
+    SandSwapOilRight,
+    SandSwapOilLeft,
+    SandToppleLeft,
+    SandIdle,
+
+    SteamRise,
+    SteamDriftLeft,
+    SteamDriftRight,
+    SteamDriftFarRight,
+    SteamDriftFarLeft,
+    SteamCondense,
+    SteamIdle,
+
+    WaterFall,
+    WaterBoil,
+    WaterQuenchRight,
+    WaterQuenchLeft,
+    WaterSinkOil,
+    WaterDiluteAcid,
+    WaterSwapOilRight,
+    WaterSwapOilLeft,
+    WaterSpread,
+    WaterIdle,
+
+    Count
+};
+
+QString toString(const Rule rule);
+
+
+class GameRuleStats
+{
+public:
+    GameRuleStats();
+
+    void clear();
+
+    inline void beginDot(const Rule idleRule);
+    inline void hit(const Rule rule);
+    void endStep();
+
+    int steps() const;
+    quint64 hits(const Rule rule) const;
+    quint64 draws(const Rule rule) const;
+
+    GameRuleStats &operator+=(const GameRuleStats &other);
+
+    QString toCsv() const;
+
+private:
+    quint64 m_hits[(int)Rule::Count];
+    quint64 m_draws[(int)Rule::Count];
+    int m_steps;
+    Rule m_current;
+    bool m_idle;
+    quint64 m_drawMark;
+
+    inline void flush();
+};
+
+/*!
+ * \brief Start to count a new dot.
+ * The dot is counted as \a idleRule if no rule branch fires.
+ */
+inline void GameRuleStats::beginDot(const Rule idleRule)
+{
+    flush();
+    m_current = idleRule;
+    m_idle = true;
+}
+
+/*!
+ * \brief Count the firing of the given \a rule branch for the current dot.
+ *
+ * The random values drawn by the conditions that lead to the branch,
+ * and by the branch itself, are attributed to the branch.
+ */
+inline void GameRuleStats::hit(const Rule rule)
+{
+    if (!m_idle) {
+        flush();
+    }
+    m_current = rule;
+    m_idle = false;
+    m_hits[(int)rule]++;
+}
+
+inline void GameRuleStats::flush()
+{
+    const quint64 count = randomDrawCount();
+    if (m_current != Rule::Count) {
+        m_draws[(int)m_current] += count - m_drawMark;
+        if (m_idle) {
+            m_hits[(int)m_current]++;
+            m_idle = false;
+        }
+    }
+    m_drawMark = count;
+}
+
+#endif // GAME_RULE_STATS_H
@@ -0,0 +1,339 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameserver.h"
+#include "gamedeltacodec.h"
+#include "gameengine.h"
+#include "gamematerial.h"
+#include "gameprotocol.h"
+#include "gameworld.h"
+
+#include <QtCore/QDataStream>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#define C_DEFAULT_KEYFRAME_INTERVAL   300  // ticks -> ~10s
+#define C_MAX_CLIENT_BACKLOG          (4 * 1024 * 1024) // bytes not yet sent
+
+/*! \class GameServer
+ *  \brief The class GameServer shares the world of a GameEngine with clients,
+ *  over TCP or local sockets.
+ *
+ * The server is authoritative: only its engine runs the game.
+ * The clients send their brush (mouse) commands, painted by the engine
+ * like the mouse, see GameEngine::setBrush(), and their Clear, Random
+ * and resize commands, applied to the shared world.
+ *
+ * After each change of the world, the server broadcasts a delta:
+ * the dirty rectangles, run-length encoded by GameDeltaCodec.
+ * The delta is encoded once for all the clients.
+ *
+ * A client receives a keyframe (the whole world) when it connects,
+ * when it asks for it, and every keyframeInterval() ticks.
+ * A client that doesn't read fast enough skips the deltas,
+ * and receives a keyframe when it catches up.
+ *
+ * \sa GameClient, GameDeltaCodec, GameProtocol
+ */
+
+GameServer::GameServer(GameEngine *engine, QObject *parent) : QObject(parent)
+  , m_engine(engine)
+  , m_tcpServer(Q_NULLPTR)
+  , m_localServer(Q_NULLPTR)
+  , m_nextBrushId(1)
+  , m_keyframeInterval(C_DEFAULT_KEYFRAME_INTERVAL)
+  , m_lastKeyframeTick(0)
+{
+    connect(m_engine, SIGNAL(changed()), this, SLOT(onEngineChanged()));
+    connect(m_engine, SIGNAL(sizeChanged()), this, SLOT(onEngineSizeChanged()));
+}
+
+GameServer::~GameServer()
+{
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Listen on the \a address, "host:port" or the name of a local socket.
+ * \sa GameProtocol
+ */
+bool GameServer::listen(const QString &address)
+{
+    if (!isSizeSupported()) {
+        m_errorString = QString("The world can't be larger than %0x%0 dots.")
+                .arg(GameDeltaCodec::maxWorldSize());
+        return false;
+    }
+    QString host;
+    quint16 port;
+    if (GameProtocol::isTcpAddress(address, &host, &port)) {
+        m_tcpServer = new QTcpServer(this);
+        const QHostAddress hostAddress = host.isEmpty()
+                ? QHostAddress(QHostAddress::Any) : QHostAddress(host);
+        if (!m_tcpServer->listen(hostAddress, port)) {
+            m_errorString = m_tcpServer->errorString();
+            return false;
+        }
+        connect(m_tcpServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    } else {
+        m_localServer = new QLocalServer(this);
+        /* A socket file left by a server that crashed */
+        QLocalServer::removeServer(address);
+        if (!m_localServer->listen(address)) {
+            m_errorString = m_localServer->errorString();
+            return false;
+        }
+        connect(m_localServer, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    }
+    return true;
+}
+
+QString GameServer::errorString() const
+{
+    return m_errorString;
+}
+
+int GameServer::clientCount() const
+{
+    return m_clients.count();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+int GameServer::keyframeInterval() const
+{
+    return m_keyframeInterval;
+}
+
+void GameServer::setKeyframeInterval(const int ticks)
+{
+    m_keyframeInterval = qMax(1, ticks);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameServer::onNewConnection()
+{
+    while (m_tcpServer && m_tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = m_tcpServer->nextPendingConnection();
+        /* The deltas are small: don't wait to fill the packets */
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        addClient(socket);
+    }
+    while (m_localServer && m_localServer->hasPendingConnections()) {
+        addClient(m_localServer->nextPendingConnection());
+    }
+}
+
+void GameServer::addClient(QIODevice *socket)
+{
+    if (!isSizeSupported()) {
+        socket->close();
+        socket->deleteLater();
+        return;
+    }
+    socket->setParent(this);
+    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    m_clients << Client{socket, m_nextBrushId++, QByteArray(), true};
+
+    /* The keyframe follows with the next change */
+    socket->write(helloMessage());
+    /* The keyframe goes with the next step, even if the world is static */
+    m_engine->wake();
+}
+
+void GameServer::onDisconnected()
+{
+    const int index = indexOf(sender());
+    if (index < 0) {
+        return;
+    }
+    const Client client = m_clients.takeAt(index);
+    m_engine->post(GameCommand::brushRemoved(client.brushId));
+    client.socket->deleteLater();
+}
+
+int GameServer::indexOf(QObject *socket) const
+{
+    for (int i = 0; i < m_clients.count(); ++i) {
+        if (m_clients.at(i).socket == socket) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameServer::onReadyRead()
+{
+    const int index = indexOf(sender());
+    if (index < 0) {
+        return;
+    }
+    Client &client = m_clients[index];
+    client.buffer += client.socket->readAll();
+    readMessages(client);
+}
+
+void GameServer::readMessages(Client &client)
+{
+    GameProtocol::MessageType type;
+    QByteArray payload;
+    GameProtocol::ReadStatus status;
+    while ((status = GameProtocol::readMessage(client.buffer, &type, &payload))
+           == GameProtocol::MessageRead) {
+        switch (type) {
+        case GameProtocol::BrushMessage:
+        {
+            QDataStream in(payload);
+            quint8 pressed;
+            qint32 x;
+            qint32 y;
+            quint8 material;
+            in >> pressed >> x >> y >> material;
+            if (in.status() == QDataStream::Ok && material < materialCount()) {
+                m_engine->post(GameCommand::brush(client.brushId, pressed, x, y, (Material)material));
+            }
+        }
+            break;
+        case GameProtocol::KeyframeRequestMessage:
+            client.needsKeyframe = true;
+            m_engine->wake();
+            break;
+        case GameProtocol::ClearMessage:
+            m_engine->post(GameCommand::clear());
+            break;
+        case GameProtocol::FillRandomlyMessage:
+            m_engine->post(GameCommand::fillRandomly());
+            break;
+        case GameProtocol::ResizeMessage:
+        {
+            QDataStream in(payload);
+            quint16 width;
+            quint16 height;
+            in >> width >> height;
+            if (in.status() == QDataStream::Ok && width > 0 && height > 0) {
+                m_engine->post(GameCommand::resize(width, height));
+            }
+        }
+            break;
+        default:
+            break;
+        }
+    }
+    if (status == GameProtocol::MessageInvalid) {
+        client.buffer.clear();
+        client.socket->close();
+    }
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return true if the size of the world fits into the messages.
+ */
+bool GameServer::isSizeSupported() const
+{
+    return m_engine->width() <= GameDeltaCodec::maxWorldSize()
+            && m_engine->height() <= GameDeltaCodec::maxWorldSize();
+}
+
+QByteArray GameServer::helloMessage() const
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << (quint16)m_engine->width() << (quint16)m_engine->height()
+        << (quint16)materialCount();
+    return GameProtocol::message(GameProtocol::HelloMessage, payload);
+}
+
+void GameServer::onEngineSizeChanged()
+{
+    if (!isSizeSupported()) {
+        qWarning("The world is too large to be shared: the clients are disconnected.");
+        for (int i = 0; i < m_clients.count(); ++i) {
+            m_clients[i].socket->close();
+        }
+        return;
+    }
+    const QByteArray hello = helloMessage();
+    for (int i = 0; i < m_clients.count(); ++i) {
+        m_clients[i].socket->write(hello);
+        m_clients[i].needsKeyframe = true;
+    }
+}
+
+/*!
+ * \brief Broadcast the dots modified by the last step, or a keyframe.
+ */
+void GameServer::onEngineChanged()
+{
+    if (m_clients.isEmpty() || !isSizeSupported()) {
+        return;
+    }
+    const GameWorld *world = m_engine->world().data();
+    const quint64 tick = m_engine->tick();
+    if (tick >= m_lastKeyframeTick + m_keyframeInterval) {
+        m_lastKeyframeTick = tick;
+        for (int i = 0; i < m_clients.count(); ++i) {
+            m_clients[i].needsKeyframe = true;
+        }
+    }
+
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out << tick;
+
+    /* Encoded once, when the first client needs it */
+    QByteArray keyframe;
+    QByteArray delta;
+    const QVector<QRect> rects = m_engine->dirtyRects();
+
+    for (int i = 0; i < m_clients.count(); ++i) {
+        Client &client = m_clients[i];
+        if (client.socket->bytesToWrite() > C_MAX_CLIENT_BACKLOG) {
+            client.needsKeyframe = true;
+            continue;
+        }
+        if (client.needsKeyframe) {
+            if (keyframe.isEmpty()) {
+                keyframe = GameProtocol::message(GameProtocol::KeyframeMessage,
+                                                 header + GameDeltaCodec::encodeKeyframe(world));
+            }
+            client.socket->write(keyframe);
+            client.needsKeyframe = false;
+        } else if (!rects.isEmpty()) {
+            if (delta.isEmpty()) {
+                delta = GameProtocol::message(GameProtocol::DeltaMessage,
+                                              header + GameDeltaCodec::encode(world, rects));
+            }
+            client.socket->write(delta);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class GameEngine;
+class GameServer : public QObject
+{
+    Q_OBJECT
+
+    struct Client {
+        QIODevice *socket;
+        int brushId;
+        QByteArray buffer;     /* received, not yet read */
+        bool needsKeyframe;    /* new, lagging or desynchronized */
+    };
+
+public:
+    explicit GameServer(GameEngine *engine, QObject *parent = 0);
+    ~GameServer();
+
+    bool listen(const QString &address);
+    QString errorString() const;
+
+    int clientCount() const;
+
+    int keyframeInterval() const;
+    void setKeyframeInterval(const int ticks);
+
+private Q_SLOTS:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onEngineChanged();
+    void onEngineSizeChanged();
+
+private:
+    GameEngine *m_engine;
+    QTcpServer *m_tcpServer;
+    QLocalServer *m_localServer;
+    QList<Client> m_clients;
+    int m_nextBrushId;
+    int m_keyframeInterval;
+    quint64 m_lastKeyframeTick;
+    QString m_errorString;
+
+    int indexOf(QObject *socket) const;
+    void addClient(QIODevice *socket);
+    void readMessages(Client &client);
+    bool isSizeSupported() const;
+    QByteArray helloMessage() const;
+};
+
+#endif // GAME_SERVER_H
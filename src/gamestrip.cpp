@@ -0,0 +1,516 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamestrip.h"
+#include "gamedeltacodec.h"
+#include "gameengine.h"
+#include "gametracer.h"
+#include "gameworld.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QThread>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#define C_CONNECT_TIMEOUT_IN_MILLISECOND 10000
+#define C_STEP_TIMEOUT_IN_MILLISECOND    30000
+#define C_NO_SOURCE                      0xffffffff
+
+/*! \class GameStrip
+ *  \brief The class GameStrip runs a horizontal strip of a world,
+ *  in a process of a distributed simulation.
+ *
+ * The world of \a height rows is split into \a count strips of consecutive rows.
+ * The strip \a index owns its rows, and its engine only evaluates them,
+ * see GameEngine::setStepRows().
+ * The local world also contains rows above and below, the halo,
+ * that mirror the rows of the neighbours. The halo is as high as
+ * the farthest write of a dot, see GameEngine::maxReach(), so that
+ * the explosions and the fire plumes of the owned rows are kept.
+ *
+ * The neighbours are connected with local sockets, named after the \a session.
+ * Each step():
+ * \list
+ * \li sends the owned rows seen by each neighbour, and receives the halo,
+ * \li runs the step,
+ * \li forwards to each neighbour the dots written into its rows (e.g. a falling
+ *     dot, or an explosion), and applies the dots written by the neighbours,
+ * \li sends back the moves of each neighbour that were not applied,
+ *     and puts back the sources of its own rejected moves.
+ * \endlist
+ *
+ * A forwarded dot is applied only if the owner didn't modify it during the step.
+ * A forwarded move also carries its source, the dot of the sender's rows
+ * that moved out (see GameEngine::moveSource()). If the owner rejects the
+ * move, the sender turns the source back into the moved dot, so that
+ * the strips keep the count of each material.
+ * Compared with a single process, the rows at the boundary of the strips
+ * see the neighbours' rows of the previous step.
+ *
+ * \sa GameProtocol
+ */
+
+GameStrip::GameStrip(const QString &session, const int index, const int count,
+                     const int width, const int height)
+  : m_session(session)
+  , m_index(index)
+  , m_count(count)
+  , m_width(width)
+  , m_height(height)
+  , m_top(0)
+  , m_haloRows(GameEngine::maxReach())
+  , m_engine(new GameEngine())
+  , m_server(Q_NULLPTR)
+{
+    for (int side = Above; side <= Below; ++side) {
+        m_neighbours[side].socket = Q_NULLPTR;
+        m_neighbours[side].top = 0;
+    }
+}
+
+GameStrip::~GameStrip()
+{
+    for (int side = Above; side <= Below; ++side) {
+        delete m_neighbours[side].socket;
+    }
+    delete m_server;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+int GameStrip::firstRowOf(const int index) const
+{
+    return (qint64)index * m_height / m_count;
+}
+
+int GameStrip::lastRowOf(const int index) const
+{
+    return firstRowOf(index + 1) - 1;
+}
+
+int GameStrip::topOf(const int index) const
+{
+    return qMax(0, firstRowOf(index) - m_haloRows);
+}
+
+int GameStrip::bottomOf(const int index) const
+{
+    return qMin(m_height - 1, lastRowOf(index) + m_haloRows);
+}
+
+/*!
+ * \brief Return the row of the whole world at the top of the local world.
+ */
+int GameStrip::top() const
+{
+    return m_top;
+}
+
+int GameStrip::firstRow() const
+{
+    return firstRowOf(m_index);
+}
+
+int GameStrip::lastRow() const
+{
+    return lastRowOf(m_index);
+}
+
+/*!
+ * \brief Return the rows of the neighbour, in the local world.
+ */
+QRect GameStrip::haloRect(const Side side) const
+{
+    if (side == Above) {
+        return QRect(0, 0, m_width, firstRow() - m_top);
+    }
+    return QRect(0, lastRow() + 1 - m_top, m_width, bottomOf(m_index) - lastRow());
+}
+
+/*!
+ * \brief Return the owned rows in the halo of the neighbour, in the local world.
+ */
+QRect GameStrip::borderRect(const Side side) const
+{
+    if (side == Above) {
+        const int last = bottomOf(m_index - 1);
+        return QRect(0, firstRow() - m_top, m_width, last - firstRow() + 1);
+    }
+    const int first = topOf(m_index + 1);
+    return QRect(0, first - m_top, m_width, lastRow() - first + 1);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Create the local world, and connect to the neighbours.
+ */
+bool GameStrip::open()
+{
+    if (m_count <= 0 || m_index < 0 || m_index >= m_count) {
+        m_errorString = QLatin1String("Invalid strip index.");
+        return false;
+    }
+    /* The halo only spans the rows of the neighbours */
+    if (m_height / m_count < m_haloRows) {
+        m_errorString = QString("The strips must have at least %0 rows.").arg(m_haloRows);
+        return false;
+    }
+
+    m_top = topOf(m_index);
+    /* The halo is encoded by GameDeltaCodec */
+    if (m_width > GameDeltaCodec::maxWorldSize()
+            || bottomOf(m_index) - m_top + 1 > GameDeltaCodec::maxWorldSize()) {
+        m_errorString = QString("The strips can't be larger than %0x%0 dots.")
+                .arg(GameDeltaCodec::maxWorldSize());
+        return false;
+    }
+    m_engine->setRunning(false);
+    m_engine->setFountainsEnabled(false);
+    m_engine->setSize(m_width, bottomOf(m_index) - m_top + 1);
+    m_engine->setStepRows(firstRow() - m_top, lastRow() - m_top);
+    m_neighbours[Above].top = topOf(m_index - 1);
+    m_neighbours[Below].top = topOf(m_index + 1);
+
+    /* Each strip listens for the strip below, and connects to the strip above */
+    const QString name = QString("%0-%1").arg(m_session);
+    if (m_index < m_count - 1) {
+        m_server = new QLocalServer();
+        QLocalServer::removeServer(name.arg(m_index));
+        if (!m_server->listen(name.arg(m_index))) {
+            m_errorString = m_server->errorString();
+            return false;
+        }
+    }
+    if (m_index > 0) {
+        QLocalSocket *socket = new QLocalSocket();
+        m_neighbours[Above].socket = socket;
+        QElapsedTimer timer;
+        timer.start();
+        forever {
+            socket->connectToServer(name.arg(m_index - 1));
+            if (socket->waitForConnected(C_CONNECT_TIMEOUT_IN_MILLISECOND)) {
+                break;
+            }
+            /* The strip above may not listen yet */
+            if (timer.elapsed() > C_CONNECT_TIMEOUT_IN_MILLISECOND) {
+                m_errorString = socket->errorString();
+                return false;
+            }
+            QThread::msleep(50);
+        }
+    }
+    if (m_index < m_count - 1) {
+        if (!m_server->waitForNewConnection(C_CONNECT_TIMEOUT_IN_MILLISECOND)) {
+            m_errorString = QLatin1String("The strip below didn't connect.");
+            return false;
+        }
+        m_neighbours[Below].socket = m_server->nextPendingConnection();
+        m_neighbours[Below].socket->setParent(Q_NULLPTR);
+    }
+    return true;
+}
+
+QString GameStrip::errorString() const
+{
+    return m_errorString;
+}
+
+GameEngine* GameStrip::engine() const
+{
+    return m_engine.data();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Exchange the halo, run the step, and exchange the forwarded dots
+ * and the rejected moves.
+ *
+ * The neighbours run their step() in lockstep.
+ */
+bool GameStrip::step()
+{
+    TRACE_SCOPE("GameStrip::step");
+
+    GameWorld *world = m_engine->world().data();
+
+    {
+        TRACE_SCOPE("GameStrip::exchangeHalo");
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (neighbour.socket && !send(neighbour, GameProtocol::HaloMessage,
+                                          GameDeltaCodec::encode(world, QVector<QRect>()
+                                                                 << borderRect((Side)side)))) {
+                return false;
+            }
+        }
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (!neighbour.socket) {
+                continue;
+            }
+            QByteArray payload;
+            if (!receive(neighbour, GameProtocol::HaloMessage, &payload)) {
+                return false;
+            }
+            if (!GameDeltaCodec::decode(payload, world, QPoint(0, neighbour.top - m_top))) {
+                m_errorString = QLatin1String("Invalid halo.");
+                return false;
+            }
+            neighbour.halo = copyRows(haloRect((Side)side));
+        }
+    }
+
+    m_engine->step();
+
+    {
+        TRACE_SCOPE("GameStrip::forwardWrites");
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (neighbour.socket && !send(neighbour, GameProtocol::WritesMessage,
+                                          diffRows(haloRect((Side)side), neighbour.halo))) {
+                return false;
+            }
+        }
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (!neighbour.socket) {
+                continue;
+            }
+            QByteArray payload;
+            if (!receive(neighbour, GameProtocol::WritesMessage, &payload)) {
+                return false;
+            }
+            if (!applyWrites(payload, &neighbour.rejects)) {
+                m_errorString = QLatin1String("Invalid forwarded dots.");
+                return false;
+            }
+        }
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (neighbour.socket && !send(neighbour, GameProtocol::RejectsMessage,
+                                          neighbour.rejects)) {
+                return false;
+            }
+        }
+        for (int side = Above; side <= Below; ++side) {
+            Neighbour &neighbour = m_neighbours[side];
+            if (!neighbour.socket) {
+                continue;
+            }
+            QByteArray payload;
+            if (!receive(neighbour, GameProtocol::RejectsMessage, &payload)) {
+                return false;
+            }
+            if (!restoreMoves(payload)) {
+                m_errorString = QLatin1String("Invalid rejected moves.");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+QByteArray GameStrip::copyRows(const QRect &rect) const
+{
+    const GameWorld *world = m_engine->world().data();
+    QByteArray rows;
+    rows.reserve(rect.width() * rect.height());
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        rows.append((const char*)world->constScanLine(y) + rect.left(), rect.width());
+    }
+    return rows;
+}
+
+/*!
+ * \brief Return the dots of \a rect modified since the copy \a before.
+ *
+ * A dot is its column, its row in the whole world,
+ * its cells before and after the step, and the column and row
+ * of the source of the move, or C_NO_SOURCE.
+ */
+QByteArray GameStrip::diffRows(const QRect &rect, const QByteArray &before) const
+{
+    const GameWorld *world = m_engine->world().data();
+    QByteArray dots;
+    QDataStream out(&dots, QIODevice::WriteOnly);
+    const uchar *previous = (const uchar*)before.constData();
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar *cells = world->constScanLine(y) + rect.left();
+        for (int x = 0; x < rect.width(); ++x) {
+            if (cells[x] != previous[x]) {
+                out << (quint16)(rect.left() + x) << (quint32)(m_top + y)
+                    << (quint8)previous[x] << (quint8)cells[x];
+                QPoint source;
+                if (m_engine->moveSource(rect.left() + x, y, &source)) {
+                    out << (quint16)source.x() << (quint32)(m_top + source.y());
+                } else {
+                    out << (quint16)0 << (quint32)C_NO_SOURCE;
+                }
+            }
+        }
+        previous += rect.width();
+    }
+    return dots;
+}
+
+/*!
+ * \brief Apply the dots forwarded by a neighbour,
+ * unless they were modified by this strip's step too.
+ *
+ * The moves not applied are appended to \a rejects, to be sent back.
+ */
+bool GameStrip::applyWrites(const QByteArray &payload, QByteArray *rejects)
+{
+    GameWorld *world = m_engine->world().data();
+    rejects->clear();
+    QDataStream in(payload);
+    QDataStream out(rejects, QIODevice::WriteOnly);
+    while (!in.atEnd()) {
+        quint16 x;
+        quint32 row;
+        quint8 before;
+        quint8 after;
+        quint16 sourceX;
+        quint32 sourceRow;
+        in >> x >> row >> before >> after >> sourceX >> sourceRow;
+        const int y = (int)row - m_top;
+        if (in.status() != QDataStream::Ok || x >= m_width
+                || (int)row < firstRow() || (int)row > lastRow()
+                || (after >> 1) >= materialCount()) {
+            return false;
+        }
+        if (world->constScanLine(y)[x] == before) {
+            world->setDot(x, y, (Material)(after >> 1), (ColorVariation)(after & 1));
+        } else if (sourceRow != C_NO_SOURCE) {
+            out << x << row << before << after << sourceX << sourceRow;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief Put back the sources of the moves rejected by a neighbour.
+ *
+ * The source of a move got the dot \a before of the target, and its dot
+ * went to the target as \a after. The dot of the source, or if it moved
+ * again during the step the nearest owned dot of the same material,
+ * is turned back into \a after.
+ */
+bool GameStrip::restoreMoves(const QByteArray &payload)
+{
+    GameWorld *world = m_engine->world().data();
+    QDataStream in(payload);
+    while (!in.atEnd()) {
+        quint16 x;
+        quint32 row;
+        quint8 before;
+        quint8 after;
+        quint16 sourceX;
+        quint32 sourceRow;
+        in >> x >> row >> before >> after >> sourceX >> sourceRow;
+        if (in.status() != QDataStream::Ok || sourceX >= m_width
+                || (int)sourceRow < firstRow() || (int)sourceRow > lastRow()
+                || (after >> 1) >= materialCount()) {
+            return false;
+        }
+        const QPoint dot = findDot((Material)(before >> 1),
+                                   QPoint(sourceX, (int)sourceRow - m_top));
+        if (dot.x() < 0) {
+            qWarning("The source of a rejected move is lost.");
+            continue;
+        }
+        world->setDot(dot.x(), dot.y(), (Material)(after >> 1), (ColorVariation)(after & 1));
+    }
+    return true;
+}
+
+/*!
+ * \brief Return the owned dot of the given \a material the nearest to \a from,
+ * row first, or (-1,-1) if none.
+ */
+QPoint GameStrip::findDot(const Material material, const QPoint &from) const
+{
+    const GameWorld *world = m_engine->world().data();
+    const int first = firstRow() - m_top;
+    const int last = lastRow() - m_top;
+    const int rows = qMax(from.y() - first, last - from.y());
+    for (int dy = 0; dy <= rows; ++dy) {
+        for (int y = from.y() - dy; y <= from.y() + dy; y += qMax(1, 2 * dy)) {
+            if (y < first || y > last) {
+                continue;
+            }
+            const uchar *cells = world->constScanLine(y);
+            for (int dx = 0; dx < m_width; ++dx) {
+                if (from.x() - dx >= 0 && (Material)(cells[from.x() - dx] >> 1) == material) {
+                    return QPoint(from.x() - dx, y);
+                }
+                if (from.x() + dx < m_width && (Material)(cells[from.x() + dx] >> 1) == material) {
+                    return QPoint(from.x() + dx, y);
+                }
+            }
+        }
+    }
+    return QPoint(-1, -1);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameStrip::send(Neighbour &neighbour, const GameProtocol::MessageType type,
+                     const QByteArray &payload)
+{
+    if (neighbour.socket->write(GameProtocol::message(type, payload)) < 0) {
+        m_errorString = neighbour.socket->errorString();
+        return false;
+    }
+    neighbour.socket->flush();
+    return true;
+}
+
+bool GameStrip::receive(Neighbour &neighbour, const GameProtocol::MessageType type,
+                        QByteArray *payload)
+{
+    forever {
+        GameProtocol::MessageType received;
+        const GameProtocol::ReadStatus status =
+                GameProtocol::readMessage(neighbour.buffer, &received, payload);
+        if (status == GameProtocol::MessageRead && received == type) {
+            return true;
+        }
+        if (status != GameProtocol::MessageIncomplete) {
+            m_errorString = QLatin1String("Unexpected message from a neighbour strip.");
+            return false;
+        }
+        if (neighbour.socket->bytesAvailable() == 0
+                && !neighbour.socket->waitForReadyRead(C_STEP_TIMEOUT_IN_MILLISECOND)) {
+            m_errorString = neighbour.socket->errorString();
+            return false;
+        }
+        neighbour.buffer += neighbour.socket->readAll();
+    }
+}
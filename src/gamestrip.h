@@ -0,0 +1,102 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_STRIP_H
+#define GAME_STRIP_H
+
+#include "gamematerial.h"
+#include "gameprotocol.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QPoint>
+#include <QtCore/QRect>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+
+class QLocalServer;
+class QLocalSocket;
+class GameEngine;
+class GameStrip
+{
+    enum Side {
+        Above = 0,
+        Below = 1
+    };
+
+    struct Neighbour {
+        QLocalSocket *socket;
+        QByteArray buffer;  /* received, not yet read */
+        int top;            /* first row of its local world */
+        QByteArray halo;    /* its rows, as seen before the step */
+        QByteArray rejects; /* its moves not applied */
+    };
+
+public:
+    explicit GameStrip(const QString &session, const int index, const int count,
+                       const int width, const int height);
+    ~GameStrip();
+
+    bool open();
+    QString errorString() const;
+
+    GameEngine* engine() const;
+    int top() const;
+    int firstRow() const;
+    int lastRow() const;
+
+    bool step();
+
+private:
+    QString m_session;
+    int m_index;
+    int m_count;
+    int m_width;
+    int m_height;
+    int m_top;
+    int m_haloRows;
+    QScopedPointer<GameEngine> m_engine;
+    QLocalServer *m_server;
+    Neighbour m_neighbours[2];
+    QString m_errorString;
+
+    int firstRowOf(const int index) const;
+    int lastRowOf(const int index) const;
+    int topOf(const int index) const;
+    int bottomOf(const int index) const;
+    QRect haloRect(const Side side) const;
+    QRect borderRect(const Side side) const;
+
+    QByteArray copyRows(const QRect &rect) const;
+    QByteArray diffRows(const QRect &rect, const QByteArray &before) const;
+    bool applyWrites(const QByteArray &payload, QByteArray *rejects);
+    bool restoreMoves(const QByteArray &payload);
+    QPoint findDot(const Material material, const QPoint &from) const;
+
+    bool send(Neighbour &neighbour, const GameProtocol::MessageType type,
+              const QByteArray &payload);
+    bool receive(Neighbour &neighbour, const GameProtocol::MessageType type,
+                 QByteArray *payload);
+};
+
+#endif // GAME_STRIP_H
@@ -0,0 +1,158 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gametiletuner.h"
+
+#include <QtCore/QThread>
+
+/* Frames measured per candidate, after a first frame to warm up */
+#define C_TUNER_WARMUP_FRAMES      1
+#define C_TUNER_MEASURED_FRAMES    4
+
+/* Re-tune when the frame time stays off by this ratio for this number of frames */
+#define C_TUNER_DRIFT_RATIO        1.5
+#define C_TUNER_DRIFT_FRAMES       60
+
+/*! \class GameTileTuner
+ * \brief The class GameTileTuner chooses the number of tiles of the
+ * concurrent renderer from the frame times measured on this machine.
+ *
+ * A calibration tries each candidate number of bands on a few frames
+ * in a row, and keeps the fastest one. The candidates are the powers of
+ * two up to 4 bands per core: with fewer bands than cores, some cores
+ * stay idle, and with too many, the cost per band dominates.
+ * The rendered frames are the real ones: the calibration doesn't block.
+ *
+ * Once tuned, the frame times are still followed. When they drift
+ * away from the calibrated one, e.g. after a zoom or with another load
+ * on the machine, a new calibration starts.
+ *
+ * \sa GameWidget
+ */
+
+GameTileTuner::GameTileTuner()
+    : m_maxBands(1)
+    , m_candidate(-1)
+    , m_frames(0)
+    , m_total(0)
+    , m_bands(1)
+    , m_reference(0)
+    , m_average(0)
+    , m_driftFrames(0)
+{
+}
+
+/*!
+ * \brief Start a calibration, with at most \a maxBands bands.
+ */
+void GameTileTuner::calibrate(const int maxBands)
+{
+    m_maxBands = maxBands;
+    const int limit = qMax(1, qMin(maxBands, 4 * QThread::idealThreadCount()));
+    m_candidates.clear();
+    for (int bands = 1; bands <= limit; bands *= 2) {
+        m_candidates << bands;
+    }
+    m_times.fill(0, m_candidates.count());
+    m_candidate = 0;
+    m_frames = 0;
+    m_total = 0;
+    m_bands = m_candidates.first();
+    m_driftFrames = 0;
+}
+
+bool GameTileTuner::isCalibrating() const
+{
+    return m_candidate >= 0;
+}
+
+/*!
+ * \brief Return the number of bands to render the next frame with.
+ */
+int GameTileTuner::bands() const
+{
+    return m_bands;
+}
+
+/*!
+ * \brief Return the frame time of the chosen number of bands, in nanoseconds,
+ * or 0 if not tuned yet.
+ */
+qint64 GameTileTuner::frameTime() const
+{
+    return m_reference;
+}
+
+/*!
+ * \brief Add the time of a rendered frame, in nanoseconds.
+ *
+ * Return true if bands() changed: the tiles must be reset.
+ */
+bool GameTileTuner::addFrame(const qint64 nsecs)
+{
+    if (!isCalibrating()) {
+        /* Moving average over ~16 frames */
+        m_average += (nsecs - m_average) / 16;
+        const bool drift = m_average > m_reference * C_TUNER_DRIFT_RATIO
+                || m_average * C_TUNER_DRIFT_RATIO < m_reference;
+        m_driftFrames = drift ? m_driftFrames + 1 : 0;
+        if (m_driftFrames < C_TUNER_DRIFT_FRAMES) {
+            return false;
+        }
+        calibrate(m_maxBands);
+        return true;
+    }
+
+    ++m_frames;
+    if (m_frames <= C_TUNER_WARMUP_FRAMES) {
+        return false;
+    }
+    m_total += nsecs;
+    if (m_frames < C_TUNER_WARMUP_FRAMES + C_TUNER_MEASURED_FRAMES) {
+        return false;
+    }
+    m_times[m_candidate] = m_total / C_TUNER_MEASURED_FRAMES;
+    m_frames = 0;
+    m_total = 0;
+
+    ++m_candidate;
+    if (m_candidate < m_candidates.count()) {
+        m_bands = m_candidates.at(m_candidate);
+        return true;
+    }
+
+    /* All the candidates are measured: keep the fastest */
+    int best = 0;
+    for (int i = 1; i < m_times.count(); ++i) {
+        if (m_times.at(i) < m_times.at(best)) {
+            best = i;
+        }
+    }
+    m_candidate = -1;
+    m_reference = m_times.at(best);
+    m_average = m_reference;
+    const bool changed = (m_bands != m_candidates.at(best));
+    m_bands = m_candidates.at(best);
+    return changed;
+}
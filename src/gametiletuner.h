@@ -0,0 +1,56 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_TILE_TUNER_H
+#define GAME_TILE_TUNER_H
+
+#include <QtCore/QVector>
+
+class GameTileTuner
+{
+public:
+    explicit GameTileTuner();
+
+    void calibrate(const int maxBands);
+    bool isCalibrating() const;
+
+    int bands() const;
+    qint64 frameTime() const;
+
+    bool addFrame(const qint64 nsecs);
+
+private:
+    int m_maxBands;
+    QVector<int> m_candidates;
+    QVector<qint64> m_times;  /* average frame time of each candidate */
+    int m_candidate;          /* candidate being measured, or -1 once tuned */
+    int m_frames;             /* frames measured with the current candidate */
+    qint64 m_total;
+    int m_bands;
+    qint64 m_reference;       /* frame time of the chosen candidate */
+    qint64 m_average;         /* moving average of the frame time, once tuned */
+    int m_driftFrames;
+};
+
+#endif // GAME_TILE_TUNER_H
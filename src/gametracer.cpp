@@ -0,0 +1,259 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gametracer.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#define C_TRACE_RING_CAPACITY   65536 // events per thread
+
+/*! \class GameTracer
+ *  \brief The class GameTracer records begin/end events of the frame phases.
+ *
+ * Each thread writes into its own fixed-size ring buffer, so recording
+ * never locks and never allocates once the thread is registered.
+ * When a ring is full, the oldest events are overwritten.
+ *
+ * Only the thread writes its ring: it publishes the count of events
+ * written, and clear() only moves the first event that dump() reads.
+ * dump() skips the events that the threads still tracing, e.g. the workers
+ * of a frame, may have overwritten while it read them.
+ * When a thread finishes, its ring shrinks to the events it recorded,
+ * and it's freed by the next clear().
+ *
+ * dump() writes the events in the Chrome trace-event JSON format,
+ * that can be opened in chrome://tracing or in the Perfetto UI.
+ *
+ * \sa GameTraceScope, TRACE_SCOPE
+ */
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    qint64 timestamp; /* in nanoseconds */
+    char phase;       /* 'B' or 'E' */
+};
+
+struct TraceRing
+{
+    int tid;
+    QString threadName;
+    QVector<TraceEvent> events;        /* event N is at N % events.count() */
+    QAtomicInteger<quint64> written;   /* count of events written, by the thread only */
+    quint64 cleared;                   /* first event to dump */
+    bool finished;                     /* the thread exited */
+};
+
+/* Unregister the ring of the thread when it exits */
+struct TraceRingOwner
+{
+    TraceRing *ring;
+    ~TraceRingOwner();
+};
+
+static QAtomicInt s_enabled(0);
+static QElapsedTimer s_clock;
+static QMutex s_registryMutex;
+static QList<TraceRing*> s_registry;
+static thread_local TraceRingOwner s_owner = { Q_NULLPTR };
+
+/*
+ * Return the index of the first event of the \a ring that can be read,
+ * up to the \a written one. Must be called with the registry locked.
+ */
+static inline quint64 firstEvent(const TraceRing *ring, const quint64 written)
+{
+    const quint64 capacity = ring->events.count();
+    return qMax(ring->cleared, written > capacity ? written - capacity : 0);
+}
+
+TraceRingOwner::~TraceRingOwner()
+{
+    if (!ring) {
+        return;
+    }
+    QMutexLocker locker(&s_registryMutex);
+    const quint64 written = ring->written.load();
+    const quint64 first = firstEvent(ring, written);
+    if (first == written) {
+        s_registry.removeOne(ring);
+        delete ring;
+        return;
+    }
+    /* Keep only the events recorded, until the next clear() */
+    QVector<TraceEvent> events;
+    events.reserve(written - first);
+    for (quint64 i = first; i < written; ++i) {
+        events << ring->events.at(i % ring->events.count());
+    }
+    ring->events = events;
+    ring->written.store(events.count());
+    ring->cleared = 0;
+    ring->finished = true;
+}
+
+static inline TraceRing* currentRing()
+{
+    if (!s_owner.ring) {
+        TraceRing *ring = new TraceRing;
+        ring->events.resize(C_TRACE_RING_CAPACITY);
+        ring->written.store(0);
+        ring->cleared = 0;
+        ring->finished = false;
+        ring->threadName = QThread::currentThread()->objectName();
+
+        QMutexLocker locker(&s_registryMutex);
+        ring->tid = s_registry.count() + 1;
+        if (ring->threadName.isEmpty()) {
+            ring->threadName = (QCoreApplication::instance()
+                                && QThread::currentThread() == QCoreApplication::instance()->thread())
+                    ? QLatin1String("GUI")
+                    : QString("Worker %0").arg(ring->tid);
+        }
+        s_registry << ring;
+        s_owner.ring = ring;
+    }
+    return s_owner.ring;
+}
+
+static inline void record(const char *name, const char phase)
+{
+    TraceRing *ring = currentRing();
+    const quint64 written = ring->written.load();
+    TraceEvent &event = ring->events[written % C_TRACE_RING_CAPACITY];
+    event.name = name;
+    event.timestamp = s_clock.nsecsElapsed();
+    event.phase = phase;
+    ring->written.storeRelease(written + 1);
+}
+
+} // namespace
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameTracer::isEnabled()
+{
+    return s_enabled.load() != 0;
+}
+
+void GameTracer::setEnabled(const bool enabled)
+{
+    if (enabled && !s_clock.isValid()) {
+        s_clock.start();
+    }
+    s_enabled.store(enabled ? 1 : 0);
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameTracer::begin(const char *name)
+{
+    record(name, 'B');
+}
+
+void GameTracer::end(const char *name)
+{
+    record(name, 'E');
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+void GameTracer::clear()
+{
+    QMutexLocker locker(&s_registryMutex);
+    foreach (TraceRing *ring, s_registry) {
+        if (ring->finished) {
+            s_registry.removeOne(ring);
+            delete ring;
+            continue;
+        }
+        ring->cleared = ring->written.loadAcquire();
+    }
+}
+
+bool GameTracer::dump(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    QMutexLocker locker(&s_registryMutex);
+    foreach (const TraceRing *ring, s_registry) {
+
+        if (!first) out << ",\n";
+        first = false;
+        out << QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%0,\"tid\":%1,"
+                       "\"args\":{\"name\":\"%2\"}}")
+               .arg(pid).arg(ring->tid).arg(ring->threadName);
+
+        /* Copy the events, then drop those overwritten meanwhile */
+        const quint64 written = ring->written.loadAcquire();
+        const quint64 first = firstEvent(ring, written);
+        QVector<TraceEvent> events;
+        events.reserve(written - first);
+        for (quint64 i = first; i < written; ++i) {
+            events << ring->events.at(i % ring->events.count());
+        }
+        const quint64 overwritten = firstEvent(ring, ring->written.loadAcquire());
+        const int skipped = (int)(qMax(first, overwritten) - first);
+
+        int depth = 0;
+        for (int i = skipped; i < events.count(); ++i) {
+            const TraceEvent &event = events.at(i);
+
+            /* The ring may have overwritten the begin of the oldest events */
+            if (event.phase == 'E') {
+                if (depth == 0) continue;
+                --depth;
+            } else {
+                ++depth;
+            }
+            out << QString(",\n{\"name\":\"%0\",\"ph\":\"%1\",\"ts\":%2,\"pid\":%3,\"tid\":%4}")
+                   .arg(QLatin1String(event.name))
+                   .arg(QLatin1Char(event.phase))
+                   .arg(event.timestamp / 1000.0, 0, 'f', 3)
+                   .arg(pid).arg(ring->tid);
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out.status() == QTextStream::Ok;
+}
@@ -0,0 +1,74 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_TRACER_H
+#define GAME_TRACER_H
+
+#include <QtCore/QString>
+
+/*
+ * Macros for frame phase tracing
+ *
+ * TRACE_SCOPE("name") records a begin event now and the matching end event
+ * when the enclosing scope exits. It costs a single flag test when the
+ * tracer is disabled.
+ */
+#define TRACE_CONCAT_IMPL(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_IMPL(A, B)
+#define TRACE_SCOPE(NAME) \
+    GameTraceScope TRACE_CONCAT(_trace_scope_, __LINE__)(NAME)
+
+
+class GameTracer
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(const bool enabled);
+
+    static void begin(const char *name);
+    static void end(const char *name);
+
+    static void clear();
+    static bool dump(const QString &fileName);
+};
+
+class GameTraceScope
+{
+public:
+    explicit GameTraceScope(const char *name)
+        : m_name(GameTracer::isEnabled() ? name : Q_NULLPTR)
+    {
+        if (m_name) GameTracer::begin(m_name);
+    }
+    ~GameTraceScope()
+    {
+        if (m_name) GameTracer::end(m_name);
+    }
+
+private:
+    const char *m_name;
+    Q_DISABLE_COPY(GameTraceScope)
+};
+
+#endif // GAME_TRACER_H
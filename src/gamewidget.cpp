@@ -26,11 +26,14 @@
 
 #include "gameengine.h"
 #include "gameworld.h"
+#include "gamelodpyramid.h"
 #include "gamerenderer.h"
+#include "gametracer.h"
 #include "perfs.h"
 
 #include <QtCore/QDebug>
 #include <QtGui/QMouseEvent>
+#include <QtGui/QWheelEvent>
 #include <QtGui/QPainter>
 #include <QtGui/QPixmapCache>
 #include <QtConcurrent/QtConcurrent>
@@ -39,35 +42,61 @@
 
 CREATE_PERFS_MEASUREMENT(666);
 
-static const char* C_PIXMAP_KEY_DOTS = "big_image_dots";
 static const char* C_PIXMAP_KEY_GRID = "big_image_grid";
 
+/* Beyond this number, the pending regions are dropped for a full repaint */
+#define C_MAX_PENDING_DIRTY_RECTS 1024
+
+#define C_ZOOM_MAX   64.0
+#define C_ZOOM_STEP   1.25 // per wheel notch
+
 GameWidget::GameWidget(QWidget *parent) : QWidget(parent)
   , m_engine(new GameEngine(this))
-  , m_threads(3)
+  , m_threads(0)
+  , m_renderMode(PaletteRenderMode)
+  , m_frameOutdated(true)
+  , m_snapshot(new GameWorld())
+  , m_frontTiles(0)
+  , m_tileFramePending(false)
+  , m_tileWatcher(new QFutureWatcher<void>(this))
+  , m_zoom(1.0)
+  , m_isPanning(false)
+  , m_lod(new GameLodPyramid())
+  , m_lodValid(false)
+  , m_chunkOverlay(false)
 {
     setCursor(Qt::CrossCursor);
     m_gridColor = "#000";
     m_gridColor.setAlpha(10);
+    m_tilesOutdated[0] = false;
+    m_tilesOutdated[1] = false;
 
     connect(m_engine, SIGNAL(changed()), this, SLOT(paintFrame()));
-    connect(m_engine, SIGNAL(sizeChanged()), this, SLOT(paint()));
+    connect(m_engine, SIGNAL(sizeChanged()), this, SLOT(resetView()));
+    connect(m_tileWatcher, SIGNAL(finished()), this, SLOT(tileFrameReady()));
 
     m_engine->setSize(160, 160);
 }
 
 GameWidget::~GameWidget()
 {
+    m_tileWatcher->waitForFinished();
+    delete m_lod;
 }
 
 void GameWidget::clear()
 {
-    m_engine->clear();
+    m_engine->post(GameCommand::clear());
 }
 
 void GameWidget::fillRandomly()
 {
-    m_engine->fillRandomly();
+    m_engine->post(GameCommand::fillRandomly());
+}
+
+GameEngine* GameWidget::engine() const
+{
+    return m_engine;
 }
 
 /***********************************************************************************
@@ -96,7 +125,7 @@ int GameWidget::worldHeight() const
 
 void GameWidget::setWorldSize(const int width, const int height)
 {
-    m_engine->setSize(width, height);
+    m_engine->post(GameCommand::resize(width, height));
 }
 
 /***********************************************************************************
@@ -106,9 +135,113 @@ int GameWidget::threadsNumber() const
     return m_threads;
 }
 
+/*!
+ * \brief Set the number of threads that the concurrent renderer is split for.
+ *
+ * With 0, the number of tiles is tuned from the frame times, see GameTileTuner.
+ */
 void GameWidget::setThreadsNumber(const int threads)
 {
+    if (m_threads == threads)
+        return;
     m_threads = threads;
+    paint();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+GameWidget::RenderMode GameWidget::renderMode() const
+{
+    return m_renderMode;
+}
+
+void GameWidget::setRenderMode(const RenderMode mode)
+{
+    if (m_renderMode == mode)
+        return;
+    m_renderMode = mode;
+    paint();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+bool GameWidget::isChunkOverlayEnabled() const
+{
+    return m_chunkOverlay;
+}
+
+/*!
+ * \brief Show the cost of each chunk of the world during the last step.
+ *
+ * \sa GameChunkStats
+ */
+void GameWidget::setChunkOverlayEnabled(const bool enabled)
+{
+    m_chunkOverlay = enabled;
+    m_engine->setChunkStatsEnabled(enabled);
+    update();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the region of the world shown in the widget, in dots.
+ *
+ * By default, the whole world is shown.
+ * The wheel zooms in and out, the right button pans the view.
+ */
+QRectF GameWidget::view() const
+{
+    const QSizeF size(m_engine->width() / m_zoom, m_engine->height() / m_zoom);
+    return QRectF(m_viewOrigin, size);
+}
+
+/*!
+ * \brief Show the whole world.
+ */
+void GameWidget::resetView()
+{
+    m_zoom = 1.0;
+    m_viewOrigin = QPointF(0, 0);
+    paint();
+}
+
+/*!
+ * \brief Zoom the view by the given \a factor, around the widget's \a pos.
+ */
+void GameWidget::zoomView(const qreal factor, const QPoint &pos)
+{
+    const QPointF anchor = mapToWorld(pos);
+    const qreal zoom = qBound((qreal)1.0, m_zoom * factor, (qreal)C_ZOOM_MAX);
+    if (qFuzzyCompare(zoom, m_zoom))
+        return;
+
+    /* The dot under the cursor stays under the cursor */
+    const QRectF v = view();
+    const qreal rx = (anchor.x() - v.x()) / v.width();
+    const qreal ry = (anchor.y() - v.y()) / v.height();
+    m_zoom = zoom;
+    const QRectF w = view();
+    m_viewOrigin = QPointF(anchor.x() - rx * w.width(), anchor.y() - ry * w.height());
+    clampView();
+    viewChanged();
+}
+
+inline void GameWidget::clampView()
+{
+    const QRectF v = view();
+    m_viewOrigin.setX(qBound((qreal)0.0, v.x(), m_engine->width() - v.width()));
+    m_viewOrigin.setY(qBound((qreal)0.0, v.y(), m_engine->height() - v.height()));
+}
+
+/*!
+ * \brief Return the position in the world, in dots, of the widget's \a pos.
+ */
+inline QPointF GameWidget::mapToWorld(const QPoint &pos) const
+{
+    const QRectF v = view();
+    return QPointF(v.x() + pos.x() * v.width() / width(),
+                   v.y() + pos.y() * v.height() / height());
 }
 
 /***********************************************************************************
@@ -120,34 +253,48 @@ void GameWidget::mousePressEvent(QMouseEvent *event)
     if (!world) return;
 
     if (event->buttons() & Qt::LeftButton) {
-        const double cellWidth = (double)width()/world->width();
-        const double cellHeight = (double)height()/world->height();
-        const int posX = qFloor(event->x()/cellWidth);
-        const int posY = qFloor(event->y()/cellHeight);
+        const QPointF pos = mapToWorld(event->pos());
+        m_engine->post(GameCommand::mouseMoved(qFloor(pos.x()), qFloor(pos.y())));
 
-        m_engine->moveMouseTo(posX, posY);
+        m_engine->post(GameCommand::mousePressed(true));
 
-        m_engine->setMousePressed(true);
+    } else if (event->buttons() & Qt::RightButton) {
+        m_isPanning = true;
+        m_panStart = event->pos();
+        m_panOrigin = m_viewOrigin;
     }
 }
 
 void GameWidget::mouseReleaseEvent(QMouseEvent *event)
 {
     Q_UNUSED(event);
-    m_engine->setMousePressed(false);
+    m_engine->post(GameCommand::mousePressed(false));
+    m_isPanning = false;
 }
 
 void GameWidget::mouseMoveEvent(QMouseEvent *event)
 {
     Q_ASSERT(m_engine);
-    QSharedPointer<GameWorld> world = m_engine->world();
 
-    const double cellWidth = (double)width()/world->width();
-    const double cellHeight = (double)height()/world->height();
-    const int posX = qFloor(event->x()/cellWidth);
-    const int posY = qFloor(event->y()/cellHeight);
+    if (m_isPanning) {
+        const QRectF v = view();
+        const QPoint delta = event->pos() - m_panStart;
+        m_viewOrigin = m_panOrigin - QPointF(delta.x() * v.width() / width(),
+                                             delta.y() * v.height() / height());
+        clampView();
+        viewChanged();
+        return;
+    }
+
+    const QPointF pos = mapToWorld(event->pos());
+    m_engine->post(GameCommand::mouseMoved(qFloor(pos.x()), qFloor(pos.y())));
+}
 
-    m_engine->moveMouseTo(posX, posY);
+void GameWidget::wheelEvent(QWheelEvent *event)
+{
+    const qreal notches = event->angleDelta().y() / 120.0;
+    zoomView(qPow(C_ZOOM_STEP, notches), event->pos());
+    event->accept();
 }
 
 /***********************************************************************************
@@ -155,26 +302,21 @@ void GameWidget::mouseMoveEvent(QMouseEvent *event)
 void GameWidget::paintEvent(QPaintEvent *)
 {
     /*
-     * We store the current frame as a QPixmap in a QPixmapCache.
+     * We store the current frame, and repaint it only when it's outdated.
      * Indeed, paintEvent() is called very often,
      * generally more frequently than the frame rate.
      */
 
     /*
-     * Q: Why do we use QPixmap (rather than QBitmap or QImage)?
-     * From the QImage documentation:
-     *    QImage is designed and optimized for I/O, and for direct pixel
-     *    access and manipulation, while QPixmap is designed and optimized
-     *    for showing images on screen."
+     * Q: Why do we use QImage (rather than QPixmap) for the frame?
+     * QPixmap can only be painted in the GUI thread, while several
+     * threads paint the frame concurrently.
+     * The grid is only painted once, so it's stored as a QPixmap.
      */
 
+    TRACE_SCOPE("GameWidget::paintEvent");
     PERFS_MEASURE_START(666);
 
-    QPixmap pm;
-    if (!QPixmapCache::find(C_PIXMAP_KEY_DOTS, &pm)) {
-        pm = generatePixmapDots();
-        QPixmapCache::insert(C_PIXMAP_KEY_DOTS, pm);
-    }
     QPixmap pgrid;
     if (!QPixmapCache::find(C_PIXMAP_KEY_GRID, &pgrid)) {
         pgrid = generatePixmapGrid();
@@ -183,11 +325,122 @@ void GameWidget::paintEvent(QPaintEvent *)
 
     QPainter widgetPainter(this);
     widgetPainter.drawPixmap(0, 0, pgrid);
-    widgetPainter.drawPixmap(0, 0, pm);
+
+    if (m_renderMode == PaletteRenderMode) {
+        /*
+         * The frame has one pixel per dot.
+         * It's scaled to the widget with a single nearest-neighbour blit.
+         */
+        if (m_frameOutdated) {
+            GameRenderer::paintImage(m_engine->world(), m_frame, m_engine->tick());
+            m_frameOutdated = false;
+        } else {
+            foreach (const QRect &rect, m_dirtyRects) {
+                GameRenderer::paintImage(m_engine->world(), m_frame, rect, m_engine->tick());
+            }
+        }
+        m_dirtyRects.clear();
+        widgetPainter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+        if (!drawLevelOfDetail(widgetPainter)) {
+            widgetPainter.drawImage(QRectF(this->rect()), m_frame, view());
+        }
+
+    } else if (m_renderMode == IndexedRenderMode) {
+        /*
+         * The world's cells are already the indexes of their colors.
+         * Nothing is rendered: the world is directly blitted,
+         * without the liquid effect.
+         */
+        widgetPainter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+        if (!drawLevelOfDetail(widgetPainter)) {
+            widgetPainter.drawImage(QRectF(this->rect()), m_engine->world()->indexedImage(), view());
+        }
+
+    } else {
+        /*
+         * The frame is rendered in background, see requestTileFrame().
+         * The last complete frame is shown until the next one is ready.
+         */
+        const QImage &frame = m_tileFrames[m_frontTiles];
+        if (!frame.isNull()) {
+            widgetPainter.drawImage(this->rect(), frame);
+        }
+    }
+
+    if (m_chunkOverlay) {
+        drawChunkOverlay(widgetPainter);
+    }
 
     PERFS_MEASURE_STOP(666);
 }
 
+/*!
+ * \brief Tint each chunk by its cost during the last step.
+ *
+ * The awake chunks are red, more opaque as they take more time,
+ * with the number of dots evaluated when there's room for it.
+ * The sleeping chunks are greyed out.
+ */
+inline void GameWidget::drawChunkOverlay(QPainter &painter)
+{
+    TRACE_SCOPE("GameWidget::drawChunkOverlay");
+
+    const GameChunkStats stats = m_engine->chunkStats();
+    const qreal maxNsecs = qMax((qint64)1, stats.maxNsecs());
+    const int size = GameWorld::chunkSize();
+    const QRectF v = view();
+
+    painter.save();
+    painter.setPen(Qt::white);
+    for (int j = qFloor(v.top()) / size; j < stats.rows(); ++j) {
+        if (j * size > v.bottom())
+            break;
+        for (int i = qFloor(v.left()) / size; i < stats.columns(); ++i) {
+            if (i * size > v.right())
+                break;
+            const QRect r = mapToWidget(QRect(i * size, j * size, size, size));
+            if (!stats.isAwake(i, j)) {
+                painter.fillRect(r, QColor(0, 0, 0, 60));
+                continue;
+            }
+            const qreal heat = stats.nsecs(i, j) / maxNsecs;
+            painter.fillRect(r, QColor(255, 0, 0, 30 + qRound(170 * heat)));
+            if (r.width() >= 32 && r.height() >= 16) {
+                painter.drawText(r, Qt::AlignCenter, QString::number(stats.updates(i, j)));
+            }
+        }
+    }
+    painter.restore();
+}
+
+/*!
+ * \brief Draw the view from the level-of-detail pyramid, if it's zoomed out
+ * below one pixel per dot.
+ *
+ * The level drawn has about one pixel per screen pixel.
+ * Return false if the view must be drawn from the world itself.
+ */
+inline bool GameWidget::drawLevelOfDetail(QPainter &painter)
+{
+    const QRectF v = view();
+    const qreal dotsPerPixel = qMax(v.width() / width(), v.height() / height());
+    if (dotsPerPixel < 2.0) {
+        return false;
+    }
+    if (!m_lodValid) {
+        m_lod->rebuild(m_engine->world().data());
+        m_lodValid = true;
+    }
+    if (m_lod->levelCount() == 0) {
+        return false;
+    }
+    const int level = qMin(qFloor(qLn(dotsPerPixel) / M_LN2), m_lod->levelCount());
+    const qreal scale = 1 << level;
+    const QRectF source(v.x() / scale, v.y() / scale, v.width() / scale, v.height() / scale);
+    painter.drawImage(QRectF(this->rect()), m_lod->level(level), source);
+    return true;
+}
+
 void GameWidget::resizeEvent(QResizeEvent *event)
 {
     Q_UNUSED(event);
@@ -198,91 +451,224 @@ void GameWidget::resizeEvent(QResizeEvent *event)
  ***********************************************************************************/
 void GameWidget::paint()
 {
-    QPixmapCache::remove(C_PIXMAP_KEY_DOTS);
     QPixmapCache::remove(C_PIXMAP_KEY_GRID);
+
+    /* The tiles are reset once the workers are done, see requestTileFrame() */
+    m_tilesOutdated[0] = true;
+    m_tilesOutdated[1] = true;
+
+    m_dirtyRects.clear();
+    m_frameOutdated = true;
+    m_lodValid = false;
+    if (m_renderMode == TileRenderMode) {
+        /* The best number of tiles depends on the sizes of the widget and the world */
+        if (m_threads == 0) {
+            m_tileTuner.calibrate(qCeil(view().height()));
+        }
+        requestTileFrame();
+    }
     update();
 }
 
-void GameWidget::paintFrame()
+/*!
+ * \brief Repaint the widget after a zoom or a pan.
+ *
+ * The frames of the Palette and Indexed modes and the pyramid
+ * hold the whole world: they don't depend on the view.
+ */
+void GameWidget::viewChanged()
 {
-    QPixmapCache::remove(C_PIXMAP_KEY_DOTS);
+    QPixmapCache::remove(C_PIXMAP_KEY_GRID);
+    if (m_renderMode == TileRenderMode) {
+        /* The tiles are reset once the workers are done, see requestTileFrame() */
+        m_tilesOutdated[0] = true;
+        m_tilesOutdated[1] = true;
+        requestTileFrame();
+    }
     update();
 }
 
+void GameWidget::paintFrame()
+{
+    if (m_chunkOverlay) {
+        update();
+    }
+
+    /* Only the regions modified by the engine are repainted */
+    const QVector<QRect> rects = m_engine->dirtyRects();
+    if (rects.isEmpty()) {
+        return;
+    }
+    if (m_renderMode == TileRenderMode) {
+        requestTileFrame();
+        return;
+    }
+    if (m_lodValid) {
+        m_lod->update(m_engine->world().data(), rects);
+    }
+    if (m_renderMode == PaletteRenderMode && !m_frameOutdated) {
+        m_dirtyRects += rects;
+        if (m_dirtyRects.count() > C_MAX_PENDING_DIRTY_RECTS) {
+            m_dirtyRects.clear();
+            m_frameOutdated = true;
+            update();
+            return;
+        }
+    }
+    foreach (const QRect &rect, rects) {
+        update(mapToWidget(rect));
+    }
+}
+
+/*!
+ * \brief Return the area of the widget covered by the dots of the given \a rect.
+ */
+inline QRect GameWidget::mapToWidget(const QRect &rect) const
+{
+    const QRectF v = view();
+    const qreal cellWidth = (qreal)width()/v.width();
+    const qreal cellHeight = (qreal)height()/v.height();
+    const int left = qFloor(cellWidth * (rect.x() - v.x()));
+    const int top = qFloor(cellHeight * (rect.y() - v.y()));
+    const int right = qCeil(cellWidth * (rect.x() + rect.width() - v.x()));
+    const int bottom = qCeil(cellHeight * (rect.y() + rect.height() - v.y()));
+    return QRect(left, top, right - left, bottom - top).intersected(this->rect());
+}
+
 
 inline QPixmap GameWidget::generatePixmapGrid()
 {
     GameRenderer::Tile tile;
     tile.world =  m_engine->world();
-    QPixmap pix(this->width(), this->height());
-    pix.fill(this->palette().background().color());
-    tile.pixmap = pix;
+    tile.view = view();
+    tile.tick = 0;
+    QImage image(this->size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(this->palette().background().color());
+    tile.image = image;
     tile.totalSize = this->size();
     GameRenderer::paintGrid(tile, m_gridColor);
-    return tile.pixmap;
+    return QPixmap::fromImage(tile.image);
 }
 
-inline QPixmap GameWidget::generatePixmapDots()
+/*!
+ * \brief Split the frame \a index in horizontal bands, one tile per band.
+ *
+ * There are two frames: the front one is shown while the back one is
+ * rendered. The tiles are kept from one frame to the next.
+ * Each tile's image is a view on its own scanlines of its frame:
+ * it doesn't own any pixels.
+ * Only the back frame is reset: the front one is still shown, stretched
+ * to the widget, until the back one is ready.
+ */
+inline void GameWidget::resetTiles(const int index)
+{
+    TRACE_SCOPE("GameWidget::resetTiles");
+
+    Q_ASSERT(m_engine && m_engine->world());
+    Q_ASSERT(!m_tileWatcher->isRunning());
+    Q_ASSERT(index != m_frontTiles);
+    QSharedPointer<GameWorld> world = m_engine->world();
+    m_tilesOutdated[index] = false;
+
+    const int count = (m_threads > 0) ? qCeil(qSqrt(m_threads)) + 1 : 1;
+    Q_ASSERT(count>0);
+    const int maxBands = (m_threads > 0) ? count * count : m_tileTuner.bands();
+
+    /* Only the visible dots are painted */
+    const QRectF v = view();
+    const int vx1 = qFloor(v.left());
+    const int vy1 = qFloor(v.top());
+    const int vx2 = qMin(qCeil(v.right()), world->width());
+    const int vy2 = qMin(qCeil(v.bottom()), world->height());
+
+    const int bands = qMin(maxBands, vy2 - vy1);
+    const qreal cellHeight = (qreal)this->height()/v.height();
+
+    QImage &frame = m_tileFrames[index];
+    if (frame.size() != this->size()) {
+        frame = QImage(this->size(), QImage::Format_ARGB32_Premultiplied);
+        frame.fill(Qt::transparent);
+    }
+
+    m_tiles[index].clear();
+    for (int j = 0; j < bands; ++j) {
+        GameRenderer::Tile tile;
+        tile.world = m_snapshot;
+        tile.view = v;
+        tile.tick = 0;
+        tile.x1 = vx1;
+        tile.y1 = vy1 + j * (vy2 - vy1) / bands;
+        tile.x2 = vx2;
+        tile.y2 = vy1 + (j+1) * (vy2 - vy1) / bands;
+
+        /* The bands are disjoint: the first and last bands end at the frame's edges */
+        const int top = (j == 0) ? 0 : qFloor(cellHeight * (tile.y1 - v.y()));
+        const int bottom = (j == bands-1) ? frame.height() : qFloor(cellHeight * (tile.y2 - v.y()));
+        tile.offset = QPoint(0, top);
+        tile.image = QImage(frame.scanLine(top), frame.width(), bottom - top,
+                            frame.bytesPerLine(), frame.format());
+        tile.totalSize = this->size();
+        m_tiles[index] << tile;
+    }
+}
+
+/*!
+ * \brief Start to render the current state of the world in background.
+ *
+ * The world is copied, so that the engine can step while the workers paint.
+ * If a frame is already being rendered, the request is postponed
+ * until it's ready: only the latest state of the world is rendered.
+ * The tiles of an outdated view are reset here, when no worker uses them.
+ */
+inline void GameWidget::requestTileFrame()
 {
     /*
      * QPainter's methods (drawLine(), drawRect(), fillRect()...)
      * are very expensive. We take advantage of thread concurrency
      * on multi-core machine to make the rendering faster.
      *
-     * We use a Map/Reduce Heuristic.
-     *
-     * The world's surface is divided in several sub-surfaces ("tiles").
+     * The frame is divided in horizontal bands of scanlines ("tiles").
      * Each tile is sent to the QtConcurrent's map methods.
      * The Qt's map method sends each tile in a separated thread
      * to be drawn concurrently.
      *
-     * Finally we copy the tiles in an unique image during the "reduce" process.
+     * The tiles paint directly in the back frame, on disjoint scanlines:
+     * there's no allocation per frame, and no reduce process.
+     * The GUI thread doesn't wait for the workers.
      */
+    TRACE_SCOPE("GameWidget::requestTileFrame");
 
-    QPixmap pm(this->size());
-    pm.fill(Qt::transparent);
-
-    Q_ASSERT(m_engine && m_engine->world());
+    if (m_tileWatcher->isRunning()) {
+        m_tileFramePending = true;
+        return;
+    }
+    m_tileFramePending = false;
 
-    const int count = (m_threads > 0) ? qCeil(qSqrt(m_threads)) + 1 : 1;
-    Q_ASSERT(count>0);
+    const int back = 1 - m_frontTiles;
+    if (m_tiles[back].isEmpty() || m_tilesOutdated[back]) {
+        resetTiles(back);
+    }
+    m_engine->world()->copyTo(m_snapshot.data());
 
-    const int tileWidth = qCeil((qreal)m_engine->world()->width()/count);
-    const int tileHeight = qCeil((qreal)m_engine->world()->height()/count);
-    const qreal pixmapWidth = (qreal)this->width()/count;
-    const qreal pixmapHeight = (qreal)this->height()/count;
-
-    // Create a list containing imageCount images.
-    QList<GameRenderer::Tile> tiles;
-    for (int i = 0; i < count; ++i) {
-        for (int j = 0; j < count; ++j) {
-            GameRenderer::Tile tile;
-            tile.world =  m_engine->world();
-            tile.x1 = i*tileWidth;
-            tile.y1 = j*tileHeight;
-            tile.x2 = qMin((i+1)*tileWidth, m_engine->world()->width());
-            tile.y2 = qMin((j+1)*tileHeight, m_engine->world()->height());
-            tile.offset = QPoint( qCeil(pixmapWidth*i), qCeil(pixmapHeight*j) );
-
-            QPixmap pix(qCeil(pixmapWidth), qCeil(pixmapHeight));
-            pix.fill(Qt::transparent);
-            tile.pixmap = pix;
-
-            tile.totalSize = this->size();
-            tiles << tile;
-        }
+    for (int i = 0; i < m_tiles[back].count(); ++i) {
+        m_tiles[back][i].tick = m_engine->tick();
     }
+    m_tileTimer.start();
+    m_tileWatcher->setFuture(QtConcurrent::map(m_tiles[back], &GameRenderer::paintTile));
+}
 
-    /* Map */
-    QtConcurrent::blockingMap(tiles, &GameRenderer::paintTile);
+void GameWidget::tileFrameReady()
+{
+    m_frontTiles = 1 - m_frontTiles;
+    update();
 
-    /* Reduce */
-    QPainter collagePainter(&pm);
-    foreach (const GameRenderer::Tile &tile, tiles) {
-        QRectF source(0.0, 0.0, tile.pixmap.width(), tile.pixmap.height());
-        QRectF target(tile.offset.x(), tile.offset.y(), tile.pixmap.width(), tile.pixmap.height());
-        collagePainter.drawPixmap(target, tile.pixmap, source);
+    if (m_threads == 0 && m_tileTuner.addFrame(m_tileTimer.nsecsElapsed())) {
+        /* The number of bands changed */
+        m_tilesOutdated[0] = true;
+        m_tilesOutdated[1] = true;
     }
 
-    return pm;
+    if (m_tileFramePending) {
+        requestTileFrame();
+    }
 }
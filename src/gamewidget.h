@@ -25,21 +25,41 @@
 #ifndef GAME_WIDGET_H
 #define GAME_WIDGET_H
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
+#include <QtCore/QPointF>
+#include <QtCore/QRect>
+#include <QtCore/QRectF>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
 #include <QtWidgets/QWidget>
 
 #include "gamematerial.h"
+#include "gamerenderer.h"
+#include "gametiletuner.h"
 
 class GameWorld;
 class GameEngine;
+class GameLodPyramid;
+class QPainter;
 
 
 class GameWidget : public QWidget
 {
     Q_OBJECT
 public:
+    enum RenderMode {
+        TileRenderMode,     /* QPainter tiles, drawn concurrently */
+        PaletteRenderMode,  /* one pixel per dot, scaled once */
+        IndexedRenderMode   /* zero-copy view of the world, scaled once */
+    };
+
     explicit GameWidget(QWidget *parent = 0);
     ~GameWidget();
 
+    GameEngine* engine() const;
+
     Material currentMaterial() const;
     void setCurrentMaterial(const Material mat);
 
@@ -50,9 +70,19 @@ public:
     int threadsNumber() const;
     void setThreadsNumber(const int threads);
 
+    RenderMode renderMode() const;
+    void setRenderMode(const RenderMode mode);
+
+    bool isChunkOverlayEnabled() const;
+    void setChunkOverlayEnabled(const bool enabled);
+
+    QRectF view() const;
+    void zoomView(const qreal factor, const QPoint &pos);
+
 public Q_SLOTS:
     void clear();
     void fillRandomly();
+    void resetView();
 
 Q_SIGNALS:
 
@@ -61,19 +91,50 @@ protected:
     void mousePressEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
+    void wheelEvent(QWheelEvent *event);
     void resizeEvent(QResizeEvent *event);
 
 private Q_SLOTS:
     void paint();
     void paintFrame();
+    void viewChanged();
+    void tileFrameReady();
 
 private:
     GameEngine* m_engine;
     QColor m_gridColor;
     int m_threads;
+    RenderMode m_renderMode;
+    QImage m_frame;
+    bool m_frameOutdated;
+    QVector<QRect> m_dirtyRects; /* in dots, not yet repainted in m_frame */
+    QSharedPointer<GameWorld> m_snapshot;  /* copy of the world read by the tiles */
+    QImage m_tileFrames[2];                /* front and back frames */
+    QList<GameRenderer::Tile> m_tiles[2];  /* bands of each frame's scanlines */
+    int m_frontTiles;                      /* index of the frame shown */
+    bool m_tileFramePending;
+    bool m_tilesOutdated[2];               /* the view changed: reset each frame's tiles */
+    QFutureWatcher<void>* m_tileWatcher;
+    GameTileTuner m_tileTuner;             /* number of bands, when m_threads is 0 */
+    QElapsedTimer m_tileTimer;             /* time of the frame being rendered */
+    qreal m_zoom;            /* 1.0 shows the whole world */
+    QPointF m_viewOrigin;    /* top-left of the view, in dots */
+    bool m_isPanning;
+    QPoint m_panStart;
+    QPointF m_panOrigin;
+    GameLodPyramid* m_lod;
+    bool m_lodValid;
+    bool m_chunkOverlay;
+
+    inline QRect mapToWidget(const QRect &rect) const;
+    inline QPointF mapToWorld(const QPoint &pos) const;
+    inline void clampView();
+    inline bool drawLevelOfDetail(QPainter &painter);
+    inline void drawChunkOverlay(QPainter &painter);
 
-    inline QPixmap generatePixmapDots();
     inline QPixmap generatePixmapGrid();
+    inline void resetTiles(const int index);
+    inline void requestTileFrame();
 
 };
 
@@ -23,8 +23,18 @@
  */
 
 #include "gameworld.h"
+#include "gameworldgenerator.h"
+#include "gametracer.h"
 
 #include <QtCore/QDebug>
+#include <QtConcurrent/QtConcurrent>
+
+/*
+ * The world is divided in chunks of 16x16 dots,
+ * to track the regions modified since the last frame.
+ */
+#define C_CHUNK_SHIFT  4
+#define C_CHUNK_SIZE  (1 << C_CHUNK_SHIFT)
 
 /*! \class GameWorld
  *  \brief The class GameWorld holds the scene of the game.
@@ -34,6 +44,16 @@
  *
  * The class GameWorld is reentrant but not thread-safe.
  *
+ * The population of each material is updated at each write,
+ * so that it never requires to scan the world.
+ *
+ * Each write that modifies a dot marks its chunk (16x16 dots) as dirty.
+ * The renderers repaint only the dirty chunks, see takeDirtyRects().
+ *
+ * The population of each chunk is updated at each write too. It's summed
+ * over the chunks on demand, so that counting the dots of a region doesn't
+ * scan the whole region, see population(material, rect).
+ *
  * \subsection sec-coord-sys Coordinate System
  *
  * The coordinates in the widget are oriented as below:
@@ -50,30 +70,130 @@
  */
 
 GameWorld::GameWorld(QObject *parent) : QObject(parent)
-  , m_world(Q_NULLPTR)
-  , m_worldColor(Q_NULLPTR)
+  , m_cells(Q_NULLPTR)
   , m_width(16)
   , m_height(16)
+  , m_stride(16)
+  , m_chunksX(1)
+  , m_chunksY(1)
+  , m_chunkPopulationValid(false)
+  , m_regionIndexValid(false)
 {
     clear();
 }
 
 GameWorld::~GameWorld()
 {
-    if (m_world) delete [] m_world;
-    if (m_worldColor) delete [] m_worldColor;
+    if (m_cells) delete [] m_cells;
 }
 
 void GameWorld::clear()
 {
-    if (m_world) delete [] m_world;
-    if (m_worldColor) delete [] m_worldColor;
+    if (!m_cells) {
+        m_cells = new uchar[m_height * m_stride];
+    }
+    memset(m_cells, encode(Material::Air, ColorVariation::Color0), sizeof(uchar) * m_height * m_stride);
+
+    m_population.fill(0, materialCount());
+    m_population[(int)Material::Air] = m_height * m_width;
 
-    m_world = new char[m_height * m_width];
-    m_worldColor = new bool[m_height * m_width];
+    /* The whole world must be repainted */
+    m_chunksY = (m_height + C_CHUNK_SIZE - 1) >> C_CHUNK_SHIFT;
+    m_chunksX = (m_width + C_CHUNK_SIZE - 1) >> C_CHUNK_SHIFT;
+    m_dirty.fill(true, m_chunksX * m_chunksY);
 
-    memset(m_world, (char)Material::Air, sizeof(char) * m_height * m_width);
-    memset(m_worldColor, false, sizeof(bool) * m_height * m_width);
+    /* The chunks of the last column and row can be partial */
+    const int count = m_population.size();
+    m_chunkPopulation.fill(0, m_chunksX * m_chunksY * count);
+    for (int j = 0; j < m_chunksY; ++j) {
+        const int h = qMin(C_CHUNK_SIZE, m_height - (j << C_CHUNK_SHIFT));
+        for (int i = 0; i < m_chunksX; ++i) {
+            const int w = qMin(C_CHUNK_SIZE, m_width - (i << C_CHUNK_SHIFT));
+            m_chunkPopulation[(j * m_chunksX + i) * count + (int)Material::Air] = w * h;
+        }
+    }
+    m_chunkPopulationValid = true;
+    invalidateRegionIndex();
+}
+
+/*
+ * Generate a band of rows. Called on a worker thread.
+ */
+struct GenerateBand
+{
+    struct Band {
+        int y;
+        QVector<int> population; /* per chunk of the band, then per material */
+    };
+
+    const GameWorldGenerator *generator;
+    uchar *cells;
+    int width;
+    int height;
+    int stride;
+    QPoint origin;
+
+    void operator()(Band &band) const
+    {
+        TRACE_SCOPE("GameWorld::generateBand");
+
+        const int rows = qMin(C_CHUNK_SIZE, height - band.y);
+        uchar *first = cells + band.y * stride;
+        generator->generate(QRect(origin.x(), origin.y() + band.y, width, rows), first, stride);
+
+        const int count = materialCount();
+        const int chunks = (width + C_CHUNK_SIZE - 1) >> C_CHUNK_SHIFT;
+        band.population.fill(0, chunks * count);
+        int *population = band.population.data();
+        for (int y = 0; y < rows; ++y) {
+            const uchar *line = first + y * stride;
+            for (int x = 0; x < width; ++x) {
+                ++population[(x >> C_CHUNK_SHIFT) * count + (line[x] >> 1)];
+            }
+        }
+    }
+};
+
+/*!
+ * \brief Fill the world with the dots of the \a generator, for the \a seed.
+ *
+ * The bands of 16 rows are generated concurrently.
+ *
+ * By default, the world is generated as a whole. Otherwise, the world
+ * is the part at \a origin of a generated world of the given \a size,
+ * e.g. a strip of a bigger world.
+ */
+void GameWorld::generate(GameWorldGenerator *generator, const uint seed,
+                         const QPoint &origin, const QSize &size)
+{
+    TRACE_SCOPE("GameWorld::generate");
+
+    const QSize whole = size.isValid() ? size : QSize(m_width, m_height);
+    generator->prepare(whole.width(), whole.height(), seed);
+
+    QVector<GenerateBand::Band> bands;
+    for (int y = 0; y < m_height; y += C_CHUNK_SIZE) {
+        bands << GenerateBand::Band{y, QVector<int>()};
+    }
+    const GenerateBand generateBand = {generator, m_cells, m_width, m_height, m_stride, origin};
+    QtConcurrent::blockingMap(bands, generateBand);
+
+    /* The bands are the rows of chunks */
+    const int count = materialCount();
+    m_population.fill(0, count);
+    m_chunkPopulation.resize(m_chunksX * m_chunksY * count);
+    int *chunkPopulation = m_chunkPopulation.data();
+    foreach (const GenerateBand::Band &band, bands) {
+        const int *population = band.population.constData();
+        for (int i = 0; i < band.population.size(); ++i) {
+            m_population[i % count] += population[i];
+        }
+        memcpy(chunkPopulation + (band.y >> C_CHUNK_SHIFT) * m_chunksX * count,
+               population, sizeof(int) * band.population.size());
+    }
+    m_chunkPopulationValid = true;
+    m_dirty.fill(true);
+    invalidateRegionIndex();
 }
 
 /***********************************************************************************
@@ -92,6 +212,12 @@ void GameWorld::setSize(const int width, const int height)
 {
     m_width  = (width>0) ? width  : 16 ;
     m_height = (height>0)? height : 16 ;
+
+    /* QImage requires 32-bit aligned scanlines */
+    m_stride = (m_width + 3) & ~3;
+
+    if (m_cells) delete [] m_cells;
+    m_cells = Q_NULLPTR;
     clear();
 }
 
@@ -100,14 +226,25 @@ void GameWorld::setSize(const int width, const int height)
 void GameWorld::setDot(const int x, const int y, const Material material)
 {
     if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
-        m_world[ y * m_width + x ] = (char)material;
+        uchar &cell = m_cells[ y * m_stride + x ];
+        write(x, y, cell, encode(material, (ColorVariation)(cell & 1)));
+    }
+}
+
+/*!
+ * \brief Write both the \a material and the \a color of the dot in one access.
+ */
+void GameWorld::setDot(const int x, const int y, const Material material, const ColorVariation color)
+{
+    if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
+        write(x, y, m_cells[ y * m_stride + x ], encode(material, color));
     }
 }
 
 Material GameWorld::dot(const int x, const int y) const
 {
     if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
-        return (Material)m_world[ y * m_width + x ];
+        return (Material)(m_cells[ y * m_stride + x ] >> 1);
     }
     return Material::Air;
 }
@@ -117,15 +254,338 @@ Material GameWorld::dot(const int x, const int y) const
 void GameWorld::setColorVariation(const int x, const int y, const ColorVariation color)
 {
     if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
-        m_worldColor[ y * m_width + x ] = (bool)color;
+        uchar &cell = m_cells[ y * m_stride + x ];
+        write(x, y, cell, (cell & ~1) | (uchar)color);
     }
 }
 
 ColorVariation GameWorld::colorVariation(const int x, const int y) const
 {
     if (x >= 0 && y >= 0 && x < m_width && y < m_height) {
-        return (ColorVariation)m_worldColor[ y * m_width + x ];
+        return (ColorVariation)(m_cells[ y * m_stride + x ] & 1);
     }
     return (ColorVariation)0;
 }
 
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the cells of the row \a y.
+ *
+ * Each cell is a byte that encodes the material and the color variation
+ * of the dot, as (2 * material + colorVariation).
+ * It's also the index of the dot's color in materialPalette().
+ */
+const uchar* GameWorld::constScanLine(const int y) const
+{
+    Q_ASSERT(y >= 0 && y < m_height);
+    return m_cells + y * m_stride;
+}
+
+/*!
+ * \brief Return the number of bytes per row, 32-bit aligned.
+ *
+ * The rows are contiguous: constScanLine(0) is the start of
+ * height() * bytesPerLine() bytes.
+ */
+int GameWorld::bytesPerLine() const
+{
+    return m_stride;
+}
+
+/*!
+ * \brief Return an indexed-color image that shares the memory of the world.
+ *
+ * The pixels are not copied: the image is a view of the world's cells,
+ * with the colors of materialPalette() as color table.
+ * The view is valid until the next call to setSize().
+ */
+QImage GameWorld::indexedImage() const
+{
+    QImage image(m_cells, m_width, m_height, m_stride, QImage::Format_Indexed8);
+    image.setColorTable(materialColorTable());
+    return image;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Copy the dots of the world into the \a other world.
+ *
+ * The buffers of \a other are reused when the sizes match,
+ * so that a snapshot of the world can be taken at each frame
+ * without allocation.
+ */
+void GameWorld::copyTo(GameWorld *other) const
+{
+    Q_ASSERT(other && other != this);
+    if (other->m_width != m_width || other->m_height != m_height) {
+        other->setSize(m_width, m_height);
+    }
+    Q_ASSERT(other->m_stride == m_stride);
+    memcpy(other->m_cells, m_cells, sizeof(uchar) * m_height * m_stride);
+    other->m_population = m_population;
+    /*
+     * The copy, e.g. the snapshot of a renderer, doesn't share the
+     * populations of the chunks: the next write into this world would
+     * copy them. The copy counts them at its first region query.
+     */
+    other->m_chunkPopulation.resize(m_chunkPopulation.size());
+    other->m_chunkPopulationValid = false;
+    other->invalidateRegionIndex();
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the size of the chunks, in dots.
+ */
+int GameWorld::chunkSize()
+{
+    return C_CHUNK_SIZE;
+}
+
+/*!
+ * \brief Return the regions modified since the last call to takeDirtyRects().
+ *
+ * The regions are in dots, aligned on the chunks of 16x16 dots.
+ * The consecutive dirty chunks of a row of chunks are merged in one rectangle.
+ * After clear() or setSize(), the whole world is returned.
+ */
+QVector<QRect> GameWorld::dirtyRects() const
+{
+    QVector<QRect> rects;
+    const int chunksY = m_dirty.size() / m_chunksX;
+    for (int j = 0; j < chunksY; ++j) {
+        const bool *row = m_dirty.constData() + j * m_chunksX;
+        int i = 0;
+        while (i < m_chunksX) {
+            if (!row[i]) {
+                ++i;
+                continue;
+            }
+            const int first = i;
+            while (i < m_chunksX && row[i]) {
+                ++i;
+            }
+            const QRect r(first << C_CHUNK_SHIFT, j << C_CHUNK_SHIFT,
+                          (i - first) << C_CHUNK_SHIFT, C_CHUNK_SIZE);
+            rects << r.intersected(QRect(0, 0, m_width, m_height));
+        }
+    }
+    return rects;
+}
+
+/*!
+ * \brief Return the regions modified since the last call, and reset them.
+ *
+ * \sa dirtyRects()
+ */
+QVector<QRect> GameWorld::takeDirtyRects()
+{
+    const QVector<QRect> rects = dirtyRects();
+    m_dirty.fill(false);
+    return rects;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return the number of dots of the given \a material in the world.
+ */
+int GameWorld::population(const Material material) const
+{
+    return m_population.at((int)material);
+}
+
+/*!
+ * \brief Return the number of dots of the given \a material in the \a rect.
+ *
+ * The chunks entirely inside the rect are summed with the index,
+ * in O(log(chunks)). Only the dots of the chunks cut by the edges
+ * of the rect are read.
+ */
+int GameWorld::population(const Material material, const QRect &rect) const
+{
+    const QRect r = rect.intersected(QRect(0, 0, m_width, m_height));
+    if (r.isEmpty()) {
+        return 0;
+    }
+
+    /* The chunks entirely inside the rect */
+    const int cx1 = (r.left() + C_CHUNK_SIZE - 1) >> C_CHUNK_SHIFT;
+    const int cy1 = (r.top() + C_CHUNK_SIZE - 1) >> C_CHUNK_SHIFT;
+    const int cx2 = (r.right() + 1) >> C_CHUNK_SHIFT;
+    const int cy2 = (r.bottom() + 1) >> C_CHUNK_SHIFT;
+    /* The partial chunks of the last column and row are inside if the rect reaches the edge */
+    const int lastX = (r.right() + 1 == m_width) ? m_chunksX : cx2;
+    const int lastY = (r.bottom() + 1 == m_height) ? m_chunksY : cy2;
+    if (cx1 >= lastX || cy1 >= lastY) {
+        return countDots(material, r);
+    }
+
+    updateRegionIndex();
+    const int m = (int)material;
+    int total = regionPrefix(m, lastX, lastY) - regionPrefix(m, cx1, lastY)
+            - regionPrefix(m, lastX, cy1) + regionPrefix(m, cx1, cy1);
+
+    /* The dots around the chunks */
+    const QRect inner(cx1 << C_CHUNK_SHIFT, cy1 << C_CHUNK_SHIFT,
+                      (lastX - cx1) << C_CHUNK_SHIFT, (lastY - cy1) << C_CHUNK_SHIFT);
+    const QRect chunks = inner.intersected(r);
+    total += countDots(material, QRect(r.left(), r.top(), r.width(), chunks.top() - r.top()));
+    total += countDots(material, QRect(r.left(), chunks.bottom() + 1,
+                                       r.width(), r.bottom() - chunks.bottom()));
+    total += countDots(material, QRect(r.left(), chunks.top(),
+                                       chunks.left() - r.left(), chunks.height()));
+    total += countDots(material, QRect(chunks.right() + 1, chunks.top(),
+                                       r.right() - chunks.right(), chunks.height()));
+    return total;
+}
+
+/*!
+ * \brief Return true if the \a rect only contains Air.
+ */
+bool GameWorld::isEmpty(const QRect &rect) const
+{
+    const QRect r = rect.intersected(QRect(0, 0, m_width, m_height));
+    return population(Material::Air, r) == r.width() * r.height();
+}
+
+/*
+ * Count the dots by reading them.
+ */
+inline int GameWorld::countDots(const Material material, const QRect &rect) const
+{
+    int count = 0;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar *line = m_cells + y * m_stride;
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            if ((Material)(line[x] >> 1) == material) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*
+ * The index is a 2D Fenwick tree per material over the chunks: the
+ * number of dots in the first chunks of the world, up to any chunk, is
+ * the sum of O(log(chunksX) * log(chunksY)) nodes.
+ *
+ * The writes only update the population of their chunk, and mark it as
+ * stale. The index catches up with the stale chunks at the next query.
+ * After clear() or generate(), it's rebuilt in O(chunks). After copyTo(),
+ * the populations of the chunks are counted first, in O(dots).
+ */
+inline void GameWorld::invalidateRegionIndex()
+{
+    m_regionIndexValid = false;
+    m_regionStale.fill(false, m_chunksX * m_chunksY);
+    m_staleChunks.clear();
+}
+
+void GameWorld::updateRegionIndex() const
+{
+    const int count = m_population.size();
+    const int chunks = m_chunksX * m_chunksY;
+
+    if (!m_chunkPopulationValid) {
+        countChunkPopulation();
+        m_regionIndexValid = false;
+    }
+    if (!m_regionIndexValid) {
+        TRACE_SCOPE("GameWorld::buildRegionIndex");
+
+        /* Linear build: each node adds itself to its parent, along x then y */
+        m_regionCounts = m_chunkPopulation;
+        m_regionTree.resize(chunks * count);
+        for (int m = 0; m < count; ++m) {
+            int *tree = m_regionTree.data() + m * chunks;
+            for (int c = 0; c < chunks; ++c) {
+                tree[c] = m_chunkPopulation.at(c * count + m);
+            }
+            for (int j = 0; j < m_chunksY; ++j) {
+                for (int i = 1; i <= m_chunksX; ++i) {
+                    const int parent = i + (i & -i);
+                    if (parent <= m_chunksX) {
+                        tree[j * m_chunksX + parent - 1] += tree[j * m_chunksX + i - 1];
+                    }
+                }
+            }
+            for (int j = 1; j <= m_chunksY; ++j) {
+                const int parent = j + (j & -j);
+                if (parent <= m_chunksY) {
+                    for (int i = 0; i < m_chunksX; ++i) {
+                        tree[(parent - 1) * m_chunksX + i] += tree[(j - 1) * m_chunksX + i];
+                    }
+                }
+            }
+        }
+        m_regionStale.fill(false, chunks);
+        m_staleChunks.clear();
+        m_regionIndexValid = true;
+        return;
+    }
+
+    foreach (const int chunk, m_staleChunks) {
+        const int cx = chunk % m_chunksX;
+        const int cy = chunk / m_chunksX;
+        for (int m = 0; m < count; ++m) {
+            const int index = chunk * count + m;
+            const int delta = m_chunkPopulation.at(index) - m_regionCounts.at(index);
+            if (delta != 0) {
+                addToRegionTree(m, cx, cy, delta);
+                m_regionCounts[index] += delta;
+            }
+        }
+        m_regionStale[chunk] = false;
+    }
+    m_staleChunks.clear();
+}
+
+void GameWorld::countChunkPopulation() const
+{
+    TRACE_SCOPE("GameWorld::countChunkPopulation");
+
+    const int count = m_population.size();
+    m_chunkPopulation.fill(0, m_chunksX * m_chunksY * count);
+    int *chunkPopulation = m_chunkPopulation.data();
+    for (int y = 0; y < m_height; ++y) {
+        const uchar *line = m_cells + y * m_stride;
+        int *row = chunkPopulation + (y >> C_CHUNK_SHIFT) * m_chunksX * count;
+        for (int x = 0; x < m_width; ++x) {
+            ++row[(x >> C_CHUNK_SHIFT) * count + (line[x] >> 1)];
+        }
+    }
+    m_chunkPopulationValid = true;
+}
+
+inline void GameWorld::addToRegionTree(const int material, const int cx, const int cy,
+                                       const int delta) const
+{
+    int *tree = m_regionTree.data() + material * m_chunksX * m_chunksY;
+    for (int j = cy + 1; j <= m_chunksY; j += j & -j) {
+        for (int i = cx + 1; i <= m_chunksX; i += i & -i) {
+            tree[(j - 1) * m_chunksX + i - 1] += delta;
+        }
+    }
+}
+
+/*
+ * Return the number of dots of the material in the chunks [0, cx) x [0, cy).
+ */
+inline int GameWorld::regionPrefix(const int material, const int cx, const int cy) const
+{
+    const int *tree = m_regionTree.constData() + material * m_chunksX * m_chunksY;
+    int sum = 0;
+    for (int j = cy; j > 0; j -= j & -j) {
+        for (int i = cx; i > 0; i -= i & -i) {
+            sum += tree[(j - 1) * m_chunksX + i - 1];
+        }
+    }
+    return sum;
+}
@@ -28,7 +28,12 @@
 #include "gamematerial.h"
 
 #include <QtCore/QObject>
+#include <QtCore/QRect>
+#include <QtCore/QSize>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
 
+class GameWorldGenerator;
 class GameWorld : public QObject
 {
     Q_OBJECT
@@ -37,6 +42,8 @@ public:
     ~GameWorld();
 
     void clear();
+    void generate(GameWorldGenerator *generator, const uint seed,
+                  const QPoint &origin = QPoint(), const QSize &size = QSize());
 
 public Q_SLOTS:
     int width() const;
@@ -45,16 +52,81 @@ public Q_SLOTS:
 
     Material dot(const int x, const int y) const;
     void setDot(const int x, const int y, const Material material);
+    void setDot(const int x, const int y, const Material material, const ColorVariation color);
 
     ColorVariation colorVariation(const int x, const int y) const;
     void setColorVariation(const int x, const int y, const ColorVariation color);
 
+public:
+    int population(const Material material) const;
+    int population(const Material material, const QRect &rect) const;
+    bool isEmpty(const QRect &rect) const;
+
+    const uchar* constScanLine(const int y) const;
+    int bytesPerLine() const;
+    QImage indexedImage() const;
+
+    static int chunkSize();
+    QVector<QRect> dirtyRects() const;
+    QVector<QRect> takeDirtyRects();
+
+    void copyTo(GameWorld *other) const;
+
 private:
-    char* m_world;       /* Material has 10 values -> stored as char */
-    bool* m_worldColor;  /* ColorVariation has 2 variants -> stored as boolean */
+    uchar* m_cells;   /* (2 * Material + ColorVariation) -> stored as uchar */
     int m_width;
     int m_height;
+    int m_stride;     /* bytes per row, 32-bit aligned */
+    QVector<int> m_population; /* number of dots per material */
+    QVector<bool> m_dirty;     /* chunks modified since takeDirtyRects() */
+    int m_chunksX;             /* number of chunks per row */
+    int m_chunksY;             /* number of rows of chunks */
+    mutable QVector<int> m_chunkPopulation;  /* number of dots per chunk and material */
+    mutable bool m_chunkPopulationValid;     /* false in a copy, see copyTo() */
+
+    /* Summed-area index over the chunks, see population(material, rect) */
+    mutable QVector<int> m_regionTree;    /* 2D Fenwick tree per material */
+    mutable QVector<int> m_regionCounts;  /* chunk populations in the tree */
+    mutable QVector<bool> m_regionStale;  /* chunks modified since in the tree */
+    mutable QVector<int> m_staleChunks;
+    mutable bool m_regionIndexValid;
+
+    inline void invalidateRegionIndex();
+    void countChunkPopulation() const;
+    void updateRegionIndex() const;
+    inline void addToRegionTree(const int material, const int cx, const int cy,
+                                const int delta) const;
+    inline int regionPrefix(const int material, const int cx, const int cy) const;
+    inline int countDots(const Material material, const QRect &rect) const;
+
+    static inline uchar encode(const Material material, const ColorVariation color);
+    inline void write(const int x, const int y, uchar &cell, const uchar value);
 
 };
 
+inline uchar GameWorld::encode(const Material material, const ColorVariation color)
+{
+    return (uchar)(((int)material << 1) | (int)color);
+}
+
+inline void GameWorld::write(const int x, const int y, uchar &cell, const uchar value)
+{
+    if (cell == value)
+        return;
+    const int chunk = (y >> 4) * m_chunksX + (x >> 4); /* see C_CHUNK_SHIFT */
+    if ((cell >> 1) != (value >> 1)) {
+        m_population[cell >> 1]--;
+        m_population[value >> 1]++;
+        int *counts = m_chunkPopulation.data() + chunk * m_population.size();
+        counts[cell >> 1]--;
+        counts[value >> 1]++;
+        if (!m_regionStale.at(chunk)) {
+            m_regionStale[chunk] = true;
+            m_staleChunks << chunk;
+        }
+    }
+    cell = value;
+    m_dirty[chunk] = true;
+}
+
 #endif // GAME_WORLD_H
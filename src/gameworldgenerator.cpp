@@ -0,0 +1,238 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameworldgenerator.h"
+#include "utils.h"
+
+#include <QtCore/qmath.h>
+
+/* Seeds of the layers of the terrain */
+#define C_LAYER_GROUND  0x1000
+#define C_LAYER_DUNES   0x2000
+#define C_LAYER_ROCK    0x3000
+#define C_LAYER_OIL     0x4000
+#define C_LAYER_COLOR   0x5000
+
+/*! \class GameWorldGenerator
+ *  \brief The class GameWorldGenerator is the base class of the generators
+ *  of the initial scene, see GameWorld::generate().
+ *
+ * prepare() is called once, then generate() is called concurrently
+ * for bands of rows: generate() must be thread-safe.
+ *
+ * The dots must only depend on the seed and their position, not on the order
+ * of the calls: the generators use hash() instead of myrandom().
+ * Hence a given seed always gives the same world.
+ */
+
+QStringList GameWorldGenerator::names()
+{
+    return QStringList() << "terrain" << "noise";
+}
+
+/*!
+ * \brief Return a new generator of the given \a name, or null if unknown.
+ * \sa names()
+ */
+GameWorldGenerator* GameWorldGenerator::create(const QString &name)
+{
+    if (name == QLatin1String("terrain")) {
+        return new GameTerrainGenerator();
+    }
+    if (name == QLatin1String("noise")) {
+        return new GameNoiseGenerator();
+    }
+    return Q_NULLPTR;
+}
+
+/*!
+ * \brief Prepare the generation of a world of \a width x \a height dots.
+ */
+void GameWorldGenerator::prepare(const int width, const int height, const uint seed)
+{
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+    Q_UNUSED(seed);
+}
+
+/*!
+ * \fn void GameWorldGenerator::generate(const QRect &rect, uchar *cells, const int stride) const
+ * \brief Write the dots of \a rect into \a cells, the first dot of \a rect.
+ * The rows are \a stride bytes apart.
+ */
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*!
+ * \brief Return a well-mixed 32-bit hash of the \a seed and the position.
+ */
+quint32 GameWorldGenerator::hash(const uint seed, const int x, const int y)
+{
+    return positionHash(seed, x, y);
+}
+
+/*!
+ * \brief Return a random value between 0 and 1 for the position.
+ */
+double GameWorldGenerator::random(const uint seed, const int x, const int y)
+{
+    return hash(seed, x, y) / 4294967296.0;
+}
+
+/*!
+ * \brief Return a smooth value noise between 0 and 1.
+ */
+double GameWorldGenerator::noise(const uint seed, const double x, const double y)
+{
+    const int x0 = qFloor(x);
+    const int y0 = qFloor(y);
+    double fx = x - x0;
+    double fy = y - y0;
+    fx = fx * fx * (3 - 2 * fx);
+    fy = fy * fy * (3 - 2 * fy);
+    const double top    = random(seed, x0, y0)   + fx * (random(seed, x0+1, y0)   - random(seed, x0, y0));
+    const double bottom = random(seed, x0, y0+1) + fx * (random(seed, x0+1, y0+1) - random(seed, x0, y0+1));
+    return top + fy * (bottom - top);
+}
+
+/*!
+ * \brief Return the sum of \a octaves layers of noise, between 0 and 1.
+ */
+double GameWorldGenerator::fractalNoise(const uint seed, const double x, const double y,
+                                        const int octaves)
+{
+    double value = 0;
+    double amplitude = 1;
+    double total = 0;
+    double frequency = 1;
+    for (int i = 0; i < octaves; ++i) {
+        value += amplitude * noise(seed + i, x * frequency, y * frequency);
+        total += amplitude;
+        amplitude *= 0.5;
+        frequency *= 2;
+    }
+    return value / total;
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*! \class GameNoiseGenerator
+ *  \brief The class GameNoiseGenerator fills the world with independent
+ *  random dots of earth, rock, water and fire.
+ */
+void GameNoiseGenerator::prepare(const int width, const int height, const uint seed)
+{
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+    m_seed = seed;
+}
+
+void GameNoiseGenerator::generate(const QRect &rect, uchar *cells, const int stride) const
+{
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        uchar *line = cells + (y - rect.top()) * stride;
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            const quint32 h = hash(m_seed, x, y);
+            const double r = (h >> 8) / 16777216.0;
+            Material mat;
+            if (r > 0.75) {
+                mat = Material::Earth;
+            } else if (r > 0.5) {
+                mat = Material::Rock;
+            } else if (r > 0.25) {
+                mat = Material::Water;
+            } else {
+                mat = Material::Fire;
+            }
+            /* The low bits are independent of r */
+            line[x - rect.left()] = cell(mat, computeColor(mat, (h & 0xFF) / 256.0));
+        }
+    }
+}
+
+/***********************************************************************************
+ ***********************************************************************************/
+/*! \class GameTerrainGenerator
+ *  \brief The class GameTerrainGenerator generates a landscape.
+ *
+ * Layered noises give, per column, the height of the earth hills
+ * and the thickness of the sand dunes over them.
+ * The earth turns into rock in depth, and contains pockets of oil.
+ * The valleys below the water level are filled with water.
+ *
+ * The features scale with the size of the world.
+ */
+
+void GameTerrainGenerator::prepare(const int width, const int height, const uint seed)
+{
+    m_seed = seed;
+    m_width = width;
+    m_height = height;
+    m_waterLevel = (int)(0.55 * height);
+
+    /* The columns are few: computed once */
+    m_ground.resize(width);
+    m_sand.resize(width);
+    const double hills = qMax(1.0, width / 3.0);
+    const double dunes = qMax(1.0, width / 16.0);
+    for (int x = 0; x < width; ++x) {
+        /* The sum of the octaves is close to 0.5: stretch it */
+        const double h = qBound(0.0, 0.5 + 2.0 * (fractalNoise(seed + C_LAYER_GROUND, x / hills, 0.5, 5) - 0.5), 1.0);
+        m_ground[x] = (int)(height * (0.3 + 0.45 * h));
+        const double d = fractalNoise(seed + C_LAYER_DUNES, x / dunes, 0.5, 3);
+        const int thickness = qMax(0, (int)(height * 0.12 * (d - 0.45)));
+        m_sand[x] = m_ground[x] - thickness;
+    }
+}
+
+void GameTerrainGenerator::generate(const QRect &rect, uchar *cells, const int stride) const
+{
+    const double rockScale = qMax(1.0, m_width / 12.0);
+    const double oilScale = qMax(1.0, m_width / 16.0);
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        uchar *line = cells + (y - rect.top()) * stride;
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            Material mat;
+            const int ground = m_ground.at(x);
+            if (y < m_sand.at(x)) {
+                mat = (y >= m_waterLevel) ? Material::Water : Material::Air;
+            } else if (y < ground) {
+                mat = Material::Sand;
+            } else {
+                const int depth = y - ground;
+                const double rock = m_height * (0.08 + 0.2 *
+                        fractalNoise(m_seed + C_LAYER_ROCK, x / rockScale, y / rockScale, 3));
+                if (depth > 4 && fractalNoise(m_seed + C_LAYER_OIL,
+                                              x / oilScale, y / oilScale, 3) > 0.7) {
+                    mat = Material::Oil;
+                } else if (depth > rock) {
+                    mat = Material::Rock;
+                } else {
+                    mat = Material::Earth;
+                }
+            }
+            line[x - rect.left()] = cell(mat, computeColor(mat, random(m_seed + C_LAYER_COLOR, x, y)));
+        }
+    }
+}
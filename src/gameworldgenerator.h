@@ -0,0 +1,85 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_WORLD_GENERATOR_H
+#define GAME_WORLD_GENERATOR_H
+
+#include "gamematerial.h"
+
+#include <QtCore/QRect>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+class GameWorldGenerator
+{
+public:
+    virtual ~GameWorldGenerator() {}
+
+    static QStringList names();
+    static GameWorldGenerator* create(const QString &name);
+
+    virtual void prepare(const int width, const int height, const uint seed);
+    virtual void generate(const QRect &rect, uchar *cells, const int stride) const = 0;
+
+protected:
+    /* Same encoding as GameWorld::constScanLine() */
+    static inline uchar cell(const Material material, const ColorVariation color)
+    { return (uchar)(((int)material << 1) | (int)color); }
+
+    static quint32 hash(const uint seed, const int x, const int y);
+    static double random(const uint seed, const int x, const int y);
+    static double noise(const uint seed, const double x, const double y);
+    static double fractalNoise(const uint seed, const double x, const double y,
+                               const int octaves);
+};
+
+/* Independent random dots, as the original fillRandomly() */
+class GameNoiseGenerator : public GameWorldGenerator
+{
+public:
+    void prepare(const int width, const int height, const uint seed) Q_DECL_OVERRIDE;
+    void generate(const QRect &rect, uchar *cells, const int stride) const Q_DECL_OVERRIDE;
+
+private:
+    uint m_seed;
+};
+
+/* Hills of earth over rock, with water basins, oil pockets and sand dunes */
+class GameTerrainGenerator : public GameWorldGenerator
+{
+public:
+    void prepare(const int width, const int height, const uint seed) Q_DECL_OVERRIDE;
+    void generate(const QRect &rect, uchar *cells, const int stride) const Q_DECL_OVERRIDE;
+
+private:
+    uint m_seed;
+    int m_width;
+    int m_height;
+    int m_waterLevel;
+    QVector<int> m_ground;    /* first row of earth, per column */
+    QVector<int> m_sand;      /* first row of sand, per column */
+};
+
+#endif // GAME_WORLD_GENERATOR_H
@@ -0,0 +1,179 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GAME_WORLD_LAYOUT_H
+#define GAME_WORLD_LAYOUT_H
+
+#include "gamematerial.h"
+#include "gameworld.h"
+
+#include <QtCore/QtGlobal>
+
+/*
+ * Read-only views of the cells of a GameWorld, for the step of GameEngine.
+ *
+ * They give the same result as GameWorld::dot(), Material::Air outside of
+ * the world, but are inlined in the step. GameStrideLayout works with any
+ * size. The others fix the stride, or the whole size, at compile time, so
+ * that the row offset is a shift and the row loop has a constant bound.
+ *
+ * Their uncheckedDot() skips the bounds check: the position must be in
+ * the world. GameInteriorLayout wraps a layout with it, for the dots
+ * whose neighbours are all in the world.
+ *
+ * The view points to the cells of the world: it is valid as long as the
+ * world is not resized. The writes still go through GameWorld::setDot().
+ */
+
+static inline const uchar* worldLayoutCells(const GameWorld *world)
+{
+    return world->height() > 0 ? world->constScanLine(0) : Q_NULLPTR;
+}
+
+/* Any size: the stride is read at runtime */
+class GameStrideLayout
+{
+public:
+    explicit GameStrideLayout(const GameWorld *world)
+        : m_cells(worldLayoutCells(world))
+        , m_width(world->width())
+        , m_height(world->height())
+        , m_stride(world->bytesPerLine())
+    {}
+
+    inline int width() const { return m_width; }
+    inline int height() const { return m_height; }
+
+    inline Material dot(const int x, const int y) const
+    {
+        if ((uint)x < (uint)m_width && (uint)y < (uint)m_height) {
+            return uncheckedDot(x, y);
+        }
+        return Material::Air;
+    }
+
+    inline Material uncheckedDot(const int x, const int y) const
+    {
+        return (Material)(m_cells[ y * m_stride + x ] >> 1);
+    }
+
+private:
+    const uchar *m_cells;
+    int m_width;
+    int m_height;
+    int m_stride;
+};
+
+/* Width of 1 << Shift: the stride is the width, the offset a shift */
+template <int Shift>
+class GamePow2Layout
+{
+public:
+    enum { Width = 1 << Shift };
+
+    explicit GamePow2Layout(const GameWorld *world)
+        : m_cells(worldLayoutCells(world))
+        , m_height(world->height())
+    {
+        Q_ASSERT(world->width() == Width && world->bytesPerLine() == Width);
+    }
+
+    inline int width() const { return Width; }
+    inline int height() const { return m_height; }
+
+    inline Material dot(const int x, const int y) const
+    {
+        if ((uint)x < (uint)Width && (uint)y < (uint)m_height) {
+            return uncheckedDot(x, y);
+        }
+        return Material::Air;
+    }
+
+    inline Material uncheckedDot(const int x, const int y) const
+    {
+        return (Material)(m_cells[ (y << Shift) | x ] >> 1);
+    }
+
+private:
+    const uchar *m_cells;
+    int m_height;
+};
+
+/* Fixed size, such as the default world of the window */
+template <int W, int H>
+class GameFixedLayout
+{
+public:
+    enum { Width = W, Height = H, Stride = (W + 3) & ~3 };
+
+    explicit GameFixedLayout(const GameWorld *world)
+        : m_cells(worldLayoutCells(world))
+    {
+        Q_ASSERT(world->width() == Width && world->height() == Height
+                 && world->bytesPerLine() == Stride);
+    }
+
+    inline int width() const { return Width; }
+    inline int height() const { return Height; }
+
+    inline Material dot(const int x, const int y) const
+    {
+        if ((uint)x < (uint)Width && (uint)y < (uint)Height) {
+            return uncheckedDot(x, y);
+        }
+        return Material::Air;
+    }
+
+    inline Material uncheckedDot(const int x, const int y) const
+    {
+        return (Material)(m_cells[ y * Stride + x ] >> 1);
+    }
+
+private:
+    const uchar *m_cells;
+};
+
+/* Any layout, read without bounds check */
+template <class Layout>
+class GameInteriorLayout
+{
+public:
+    explicit GameInteriorLayout(const Layout &layout)
+        : m_layout(layout)
+    {}
+
+    inline int width() const { return m_layout.width(); }
+    inline int height() const { return m_layout.height(); }
+
+    inline Material dot(const int x, const int y) const
+    {
+        Q_ASSERT((uint)x < (uint)m_layout.width() && (uint)y < (uint)m_layout.height());
+        return m_layout.uncheckedDot(x, y);
+    }
+
+private:
+    const Layout &m_layout;
+};
+
+#endif // GAME_WORLD_LAYOUT_H
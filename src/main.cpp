@@ -23,12 +23,489 @@
  */
 
 #include "mainwindow.h"
+#include "gamebatchrunner.h"
+#include "gameclient.h"
+#include "gameengine.h"
+#include "gameexporter.h"
+#include "gamematerialrules.h"
+#include "gameplayback.h"
+#include "gameserver.h"
+#include "gamestrip.h"
+#include "gameworldgenerator.h"
+#include "gametracer.h"
+#include "gameworld.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QProcess>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtWidgets/QApplication>
 
+/*
+ * Publish the frames into the shared memory, if requested.
+ */
+static bool startPublishing(GameEngine *engine, const QCommandLineParser &parser)
+{
+    if (!parser.isSet("publish")) {
+        return true;
+    }
+    QString errorString;
+    if (!engine->startPublishing(parser.value("publish"),
+                                 parser.value("slots").toInt(), &errorString)) {
+        QTextStream(stderr) << errorString << endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Record the steps into the file --record, if requested.
+ */
+static bool startRecording(GameEngine *engine, const QCommandLineParser &parser)
+{
+    if (!parser.isSet("record")) {
+        return true;
+    }
+    QString errorString;
+    if (!engine->startRecording(parser.value("record"),
+                                parser.value("keyframes").toInt(), &errorString)) {
+        QTextStream(stderr) << errorString << endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Fill the world with the generator --generator, for the seed --seed.
+ * The world is the part at origin of a world of the given size.
+ */
+static bool generateWorld(GameEngine *engine, const QCommandLineParser &parser,
+                          const QPoint &origin = QPoint(), const QSize &size = QSize())
+{
+    QScopedPointer<GameWorldGenerator> generator(
+                GameWorldGenerator::create(parser.value("generator")));
+    if (!generator) {
+        QTextStream(stderr) << QString("Unknown generator '%0', expected: %1.")
+                               .arg(parser.value("generator"))
+                               .arg(GameWorldGenerator::names().join(", ")) << endl;
+        return false;
+    }
+    engine->generate(generator.data(), parser.value("seed").toUInt(), origin, size);
+    return true;
+}
+
+/*
+ * Size and fill the world of a headless engine.
+ */
+static bool setupWorld(GameEngine *engine, const QCommandLineParser &parser)
+{
+    const QStringList size = parser.value("size").split('x');
+    const int width = size.value(0).toInt();
+    const int height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        QTextStream(stderr) << "Invalid --size." << endl;
+        return false;
+    }
+    engine->setSize(width, height);
+    if (parser.isSet("random")) {
+        return generateWorld(engine, parser);
+    }
+    return true;
+}
+
+/*
+ * Run the simulation without display, and share it with the clients.
+ */
+static int runServer(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    GameEngine engine;
+    engine.setHashedColorsEnabled(parser.isSet("hashed-colors"));
+    engine.setFountainsEnabled(!parser.isSet("no-fountains"));
+    if (!setupWorld(&engine, parser) || !startPublishing(&engine, parser)
+            || !startRecording(&engine, parser)) {
+        return 1;
+    }
+
+    GameServer server(&engine);
+    server.setKeyframeInterval(parser.value("keyframes").toInt());
+    if (!server.listen(parser.value("serve"))) {
+        err << QString("Cannot listen on '%0': %1")
+               .arg(parser.value("serve")).arg(server.errorString()) << endl;
+        return 1;
+    }
+    err << QString("Serving on '%0'").arg(parser.value("serve")) << endl;
+    return QCoreApplication::exec();
+}
+
+/*
+ * Run many independent worlds concurrently, and print their final statistics.
+ */
+static int runBatch(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+    QTextStream out(stdout);
+
+    const int count = parser.value("batch").toInt();
+    const int steps = parser.value("steps").toInt();
+    const QStringList size = parser.value("size").split('x');
+    const int width = size.value(0).toInt();
+    const int height = size.value(1).toInt();
+    if (count <= 0 || steps <= 0 || width <= 0 || height <= 0) {
+        err << "Invalid --batch, --steps or --size." << endl;
+        return 1;
+    }
+    const uint seed = parser.value("seed").toUInt();
+
+    GameBatchRunner runner(count, width, height, steps, seed);
+    runner.setRandomFill(parser.isSet("random"));
+    runner.setMixedLayouts(parser.isSet("mixed"));
+    runner.setHashedColors(parser.isSet("hashed-colors"));
+    runner.run();
+
+    /* One CSV line per world */
+    out << "world,seed,layout,msecs";
+    for (int i = 0; i < materialCount(); ++i) {
+        out << ',' << toString((Material)i);
+    }
+    out << endl;
+    foreach (const GameBatchRunner::Result &result, runner.results()) {
+        out << result.index << ',' << result.seed << ','
+            << (result.random ? "random" : "fountains") << ','
+            << QString::number(result.nsecs / 1e6, 'f', 3);
+        foreach (const int population, result.population) {
+            out << ',' << population;
+        }
+        out << endl;
+    }
+
+    err << QString("%0 worlds of %1x%2, %3 steps each, in %4 ms: %5 steps/s on %6 threads")
+           .arg(count).arg(width).arg(height).arg(steps).arg(runner.elapsed())
+           .arg(runner.stepsPerSecond(), 0, 'f', 0)
+           .arg(QThreadPool::globalInstance()->maxThreadCount()) << endl;
+    return 0;
+}
+
+/*
+ * Run the strip --strip of a distributed simulation.
+ */
+static int runStrip(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    const int index = parser.value("strip").toInt();
+    const int count = parser.value("strips").toInt();
+    const int steps = parser.value("steps").toInt();
+    const QStringList size = parser.value("size").split('x');
+    GameStrip strip(parser.value("session"), index, count,
+                    size.value(0).toInt(), size.value(1).toInt());
+    if (!strip.open()) {
+        err << QString("Strip %0: %1").arg(index).arg(strip.errorString()) << endl;
+        return 1;
+    }
+    strip.engine()->setHashedColorsEnabled(parser.isSet("hashed-colors"));
+    if (parser.isSet("random") && !generateWorld(strip.engine(), parser,
+                                                 QPoint(0, strip.top()),
+                                                 QSize(size.value(0).toInt(), size.value(1).toInt()))) {
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < steps; ++i) {
+        if (!strip.step()) {
+            err << QString("Strip %0: %1").arg(index).arg(strip.errorString()) << endl;
+            return 1;
+        }
+    }
+    err << QString("Strip %0 (rows %1-%2): %3 steps in %4 ms")
+           .arg(index).arg(strip.firstRow()).arg(strip.lastRow())
+           .arg(steps).arg(timer.elapsed()) << endl;
+    return 0;
+}
+
+/*
+ * Run a distributed simulation: start one process per strip, and wait for them.
+ */
+static int runDistributed(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    const int count = parser.value("strips").toInt();
+    const QStringList size = parser.value("size").split('x');
+    if (count <= 0 || parser.value("steps").toInt() <= 0
+            || size.value(0).toInt() <= 0 || size.value(1).toInt() <= 0) {
+        err << "Invalid --strips, --steps or --size." << endl;
+        return 1;
+    }
+
+    QStringList arguments;
+    arguments << "--headless"
+              << "--strips" << QString::number(count)
+              << "--session" << QString("elementdots-%0").arg(QCoreApplication::applicationPid())
+              << "--size" << parser.value("size")
+              << "--steps" << parser.value("steps");
+    if (parser.isSet("random")) {
+        /* All the strips generate the same world */
+        arguments << "--random"
+                  << "--generator" << parser.value("generator")
+                  << "--seed" << parser.value("seed");
+    }
+    if (parser.isSet("materials")) {
+        arguments << "--materials" << parser.value("materials");
+    }
+    if (parser.isSet("hashed-colors")) {
+        arguments << "--hashed-colors";
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<QProcess*> processes;
+    for (int i = 0; i < count; ++i) {
+        QStringList stripArguments = arguments;
+        stripArguments << "--strip" << QString::number(i);
+        QProcess *process = new QProcess();
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->start(QCoreApplication::applicationFilePath(), stripArguments);
+        processes << process;
+    }
+    int ret = 0;
+    foreach (QProcess *process, processes) {
+        if (!process->waitForFinished(-1)
+                || process->exitStatus() != QProcess::NormalExit
+                || process->exitCode() != 0) {
+            ret = 1;
+        }
+    }
+    qDeleteAll(processes);
+
+    err << QString("%0 strips, %1 steps in %2 ms")
+           .arg(count).arg(parser.value("steps")).arg(timer.elapsed()) << endl;
+    return ret;
+}
+
+/*
+ * Export a frame every N records of a recording, from the tick --seek.
+ */
+static int runPlayback(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    const int steps = parser.value("steps").toInt();
+    const int every = qMax(1, parser.value("every").toInt());
+    if (steps <= 0) {
+        err << "Invalid --steps." << endl;
+        return 1;
+    }
+
+    GamePlayback playback(parser.value("play"));
+    if (!playback.open()) {
+        err << playback.errorString() << endl;
+        return 1;
+    }
+    const quint64 tick = parser.isSet("seek")
+            ? parser.value("seek").toULongLong()
+            : playback.firstTick();
+
+    QElapsedTimer timer;
+    timer.start();
+    GameWorld world;
+    if (!playback.seek(tick, &world)) {
+        err << playback.errorString() << endl;
+        return 1;
+    }
+    err << QString("Tick %0 in %1 ms").arg(playback.tick()).arg(timer.elapsed()) << endl;
+
+    GameExporter exporter(parser.value("output"), parser.value("queue").toInt());
+    if (!exporter.open()) {
+        err << exporter.errorString() << endl;
+        return 1;
+    }
+    for (int i = 0; i < steps; ++i) {
+        if (i % every == 0 && !exporter.exportFrame(&world)) {
+            err << exporter.errorString() << endl;
+            return 1;
+        }
+        if (!playback.next(&world)) {
+            break;
+        }
+    }
+    if (!exporter.finish()) {
+        err << exporter.errorString() << endl;
+        return 1;
+    }
+
+    err << QString("%0 frames, up to tick %1 of %2")
+           .arg(exporter.frameCount()).arg(playback.tick()).arg(playback.lastTick()) << endl;
+    return 0;
+}
+
+/*
+ * Run the simulation without display, and export a frame every N steps.
+ */
+static int runHeadless(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    const int steps = parser.value("steps").toInt();
+    const int every = qMax(1, parser.value("every").toInt());
+    if (steps <= 0) {
+        err << "Invalid --steps." << endl;
+        return 1;
+    }
+
+    GameEngine engine;
+    engine.setRunning(false);
+    engine.setHashedColorsEnabled(parser.isSet("hashed-colors"));
+    engine.setFountainsEnabled(!parser.isSet("no-fountains"));
+    if (!setupWorld(&engine, parser) || !startPublishing(&engine, parser)
+            || !startRecording(&engine, parser)) {
+        return 1;
+    }
+
+    GameExporter exporter(parser.value("output"), parser.value("queue").toInt());
+    if (!exporter.open()) {
+        err << exporter.errorString() << endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 1; i <= steps; ++i) {
+        engine.step();
+        if (i % every == 0 && !exporter.exportFrame(engine.world().data())) {
+            err << exporter.errorString() << endl;
+            return 1;
+        }
+    }
+    if (!exporter.finish()) {
+        err << exporter.errorString() << endl;
+        return 1;
+    }
+
+    err << QString("%0 steps, %1 frames in %2 ms")
+           .arg(steps).arg(exporter.frameCount()).arg(timer.elapsed()) << endl;
+    return 0;
+}
+
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0
+                || qstrcmp(argv[i], "--serve") == 0
+                || qstrncmp(argv[i], "--serve=", 8) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
-    MainWindow w;
-    w.show();
-    return app.exec();
+    /* The headless mode doesn't require any display */
+    QScopedPointer<QCoreApplication> app(isHeadless(argc, argv)
+                                         ? new QCoreApplication(argc, argv)
+                                         : new QApplication(argc, argv));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("ElementDots");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"materials", "Load the material definitions from the given JSON file.", "file"},
+        {"publish", "Publish each frame into the POSIX shared memory of the given name, "
+                    "for external viewers and tools.", "name"},
+        {"slots", "Number of frames in the shared memory ring.", "count", "8"},
+        {"hashed-colors", "Derive the color variation of the dots from their position "
+                          "instead of a random value."},
+        {"no-fountains", "Don't spawn the dots of the fountains, so that "
+                         "a settled world idles (window, headless or server)."},
+        {"headless", "Run without display and export the frames."},
+        {"steps", "Number of steps to run (headless).", "count", "1000"},
+        {"every", "Export a frame every N steps (headless).", "N", "10"},
+        {"output", "Frame file name pattern, with %1 for the frame number "
+                   "and a .png or .ppm extension, or - for raw RGB24 "
+                   "frames on the standard output (headless).", "pattern", "frame_%1.png"},
+        {"serve", "Run without display, and share the world with the clients "
+                  "on the given address, host:port or a local socket name.", "address"},
+        {"keyframes", "Send or record the whole world every N steps (server, record).",
+         "N", "300"},
+        {"record", "Record the steps into the given file, for --play.", "file"},
+        {"play", "Export the frames of the given recording, from the tick --seek "
+                 "(headless).", "file"},
+        {"seek", "First tick to export from the recording (headless).", "tick"},
+        {"batch", "Run N independent worlds concurrently, and print their final "
+                  "populations as CSV (headless).", "N"},
+        {"seed", "Seed of the generated world, or of the first world of a batch "
+                 "(the next ones are seed+1, seed+2...).", "seed",
+         QString::number((uint)QDateTime::currentMSecsSinceEpoch())},
+        {"generator", QString("Generator of the random world: %0.")
+                      .arg(GameWorldGenerator::names().join(", ")), "name", "terrain"},
+        {"mixed", "Alternate the random and the fountain layouts (batch)."},
+        {"strips", "Split the world into N horizontal strips, each run by "
+                   "a process (headless).", "N"},
+        {"strip", "Run only the given strip, started by --strips (internal).", "index"},
+        {"session", "Name of the distributed simulation (internal).", "name"},
+        {"connect", "Show the world of the server on the given address.", "address"},
+        {"size", "Size of the world (headless or server).", "WxH", "160x160"},
+        {"random", "Generate the world first (headless or server)."},
+        {"queue", "Maximum number of frames being encoded (headless).", "count",
+         QString::number(2 * QThread::idealThreadCount())}
+    });
+    parser.process(*app);
+
+    /* The new materials must be known before any world is created */
+    if (parser.isSet("materials")) {
+        QString errorString;
+        if (!GameMaterialRules::load(parser.value("materials"), &errorString)) {
+            QTextStream(stderr) << "Can't load the materials: " << errorString << endl;
+            return 1;
+        }
+    }
+
+    /* Opt-in tracing from the start, dumped at exit */
+    const QString traceFile = QString::fromLocal8Bit(qgetenv("ELEMENTDOTS_TRACE"));
+    if (!traceFile.isEmpty()) {
+        GameTracer::setEnabled(true);
+    }
+
+    int ret;
+    if (parser.isSet("serve")) {
+        ret = runServer(parser);
+    } else if (parser.isSet("headless") && parser.isSet("strip")) {
+        ret = runStrip(parser);
+    } else if (parser.isSet("headless") && parser.isSet("play")) {
+        ret = runPlayback(parser);
+    } else if (parser.isSet("headless") && parser.isSet("batch")) {
+        ret = runBatch(parser);
+    } else if (parser.isSet("headless") && parser.isSet("strips")) {
+        ret = runDistributed(parser);
+    } else if (parser.isSet("headless")) {
+        ret = runHeadless(parser);
+    } else {
+        MainWindow w;
+        w.engine()->setHashedColorsEnabled(parser.isSet("hashed-colors"));
+        w.setFountainsEnabled(!parser.isSet("no-fountains"));
+        if (!startPublishing(w.engine(), parser) || !startRecording(w.engine(), parser)) {
+            return 1;
+        }
+        QScopedPointer<GameClient> client;
+        if (parser.isSet("connect")) {
+            client.reset(new GameClient(w.engine()));
+            client->connectToServer(parser.value("connect"));
+            w.setClient(client.data());
+        }
+        w.show();
+        ret = app->exec();
+    }
+
+    if (!traceFile.isEmpty() && GameTracer::isEnabled()) {
+        GameTracer::setEnabled(false);
+        GameTracer::dump(traceFile);
+    }
+    return ret;
 }
@@ -27,12 +27,19 @@
 
 #include "about.h"
 #include "globals.h"
+#include "gameclient.h"
+#include "gameengine.h"
 #include "gamewidget.h"
+#include "gametracer.h"
 
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtWidgets/QFileDialog>
 #include <QtWidgets/QMessageBox>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
   , ui(new Ui::MainWindow)
+  , m_client(Q_NULLPTR)
 {
     ui->setupUi(this);
 
@@ -49,6 +56,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     ui->radioButton_sand->setMaterial( Material::Sand );
     ui->radioButton_water->setMaterial( Material::Water );
 
+    ui->rendererComboBox->addItem(tr("Palette"), GameWidget::PaletteRenderMode);
+    ui->rendererComboBox->addItem(tr("Indexed"), GameWidget::IndexedRenderMode);
+    ui->rendererComboBox->addItem(tr("Tiles"), GameWidget::TileRenderMode);
+
+    connect(ui->actionFountains, SIGNAL(toggled(bool)), this, SLOT(enableFountains(bool)));
+    connect(ui->actionRecordTrace, SIGNAL(toggled(bool)), this, SLOT(recordTrace(bool)));
+    connect(ui->actionProfileRules, SIGNAL(toggled(bool)), this, SLOT(profileRules(bool)));
+    connect(ui->actionChunkHeatmap, SIGNAL(toggled(bool)), this, SLOT(showChunkHeatmap(bool)));
     connect(ui->actionAbout, SIGNAL(triggered()), this, SLOT(about()));
 
     connect(ui->radioButton_acid,   SIGNAL(released()), this, SLOT(onRadioChanged()));
@@ -61,6 +76,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     connect(ui->radioButton_sand,   SIGNAL(released()), this, SLOT(onRadioChanged()));
     connect(ui->radioButton_water,  SIGNAL(released()), this, SLOT(onRadioChanged()));
 
+    /* The materials of the definition file, after Earth */
+    int index = ui->verticalLayout_2->indexOf(ui->radioButton_earth);
+    for (int i = (int)Material::Water + 1; i < materialCount(); ++i) {
+        const Material material = (Material)i;
+        const QString name = toString(material).section(QLatin1String("::"), 1);
+        MaterialRadioButton *radio = new MaterialRadioButton(name.left(1).toUpper() + name.mid(1), ui->widget);
+        radio->setMaterial(material);
+        ui->verticalLayout_2->insertWidget(++index, radio);
+        connect(radio, SIGNAL(released()), this, SLOT(onRadioChanged()));
+    }
+
     connect(ui->clearButton, SIGNAL(released()), ui->gamewidget, SLOT(clear()));
     connect(ui->randomFillButton, SIGNAL(released()), ui->gamewidget, SLOT(fillRandomly()));
     connect(ui->applyOptionButton, SIGNAL(released()), this, SLOT(apply()));
@@ -72,6 +98,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     ui->radioButton_earth->setChecked(false);
     ui->radioButton_earth->setChecked(true);
     ui->gamewidget->setCurrentMaterial(Material::Earth);
+
+    ui->actionFountains->setChecked(engine()->isFountainsEnabled());
+    ui->actionRecordTrace->setChecked(GameTracer::isEnabled());
 }
 
 MainWindow::~MainWindow()
@@ -79,13 +108,48 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+GameEngine* MainWindow::engine() const
+{
+    return ui->gamewidget->engine();
+}
+
+/*!
+ * \brief Show the world of the \a client's server.
+ *
+ * The Clear, Random and Apply buttons act on the server's world,
+ * and the size of the world follows the server's one.
+ */
+void MainWindow::setClient(GameClient *client)
+{
+    m_client = client;
+    disconnect(ui->clearButton, SIGNAL(released()), ui->gamewidget, SLOT(clear()));
+    disconnect(ui->randomFillButton, SIGNAL(released()), ui->gamewidget, SLOT(fillRandomly()));
+    connect(ui->clearButton, SIGNAL(released()), m_client, SLOT(requestClear()));
+    connect(ui->randomFillButton, SIGNAL(released()), m_client, SLOT(requestFillRandomly()));
+    connect(engine(), SIGNAL(sizeChanged()), this, SLOT(onWorldSizeChanged()));
+
+    /* The fountains are the server's ones */
+    ui->actionFountains->setEnabled(false);
+}
+
+/*!
+ * \brief Spawn the dots of the fountains, or not.
+ *
+ * Without fountains, a settled world lets the engine idle.
+ */
+void MainWindow::setFountainsEnabled(const bool enabled)
+{
+    ui->actionFountains->setChecked(enabled);
+}
+
 /***********************************************************************************
  ***********************************************************************************/
 void MainWindow::reset()
 {
     ui->heightSpinBox->setValue(160);
     ui->widthSpinBox->setValue(160);
-    ui->threadsSpinBox->setValue(3);
+    ui->threadsSpinBox->setValue(0);
+    ui->rendererComboBox->setCurrentIndex(0);
     apply();
 }
 
@@ -99,17 +163,79 @@ void MainWindow::onRadioChanged()
     }
 }
 
+void MainWindow::onWorldSizeChanged()
+{
+    ui->widthSpinBox->setValue(engine()->width());
+    ui->heightSpinBox->setValue(engine()->height());
+}
+
 void MainWindow::apply()
 {
     const int w = ui->widthSpinBox->value();
     const int h = ui->heightSpinBox->value();
     const int threads = ui->threadsSpinBox->value();
     if (w > 0 && h > 0) {
-        ui->gamewidget->setWorldSize(w, h);
+        if (m_client) {
+            m_client->requestResize(w, h);
+        } else {
+            ui->gamewidget->setWorldSize(w, h);
+        }
     }else {
         QMessageBox::warning(this, tr("Error"), tr("The world must have width > 0 and height > 0.") );
     }
     ui->gamewidget->setThreadsNumber(threads);
+    ui->gamewidget->setRenderMode(
+                (GameWidget::RenderMode)ui->rendererComboBox->currentData().toInt());
+}
+
+void MainWindow::enableFountains(bool checked)
+{
+    engine()->setFountainsEnabled(checked);
+}
+
+void MainWindow::recordTrace(bool checked)
+{
+    if (checked) {
+        GameTracer::clear();
+        GameTracer::setEnabled(true);
+        return;
+    }
+    GameTracer::setEnabled(false);
+    const QString fileName = QFileDialog::getSaveFileName(
+                this, tr("Save Frame Trace"), QLatin1String("trace.json"),
+                tr("Chrome Trace (*.json)"));
+    if (!fileName.isEmpty() && !GameTracer::dump(fileName)) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot write the trace to '%0'.").arg(fileName));
+    }
+}
+
+void MainWindow::profileRules(bool checked)
+{
+    GameEngine *engine = ui->gamewidget->engine();
+    if (checked) {
+        engine->resetRuleStats();
+        engine->setRuleStatsEnabled(true);
+        return;
+    }
+    engine->setRuleStatsEnabled(false);
+    const QString fileName = QFileDialog::getSaveFileName(
+                this, tr("Save Rule Counters"), QLatin1String("rules.csv"),
+                tr("CSV Table (*.csv)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot write the counters to '%0'.").arg(fileName));
+        return;
+    }
+    QTextStream out(&file);
+    out << engine->ruleStatsTotal().toCsv();
+}
+
+void MainWindow::showChunkHeatmap(bool checked)
+{
+    ui->gamewidget->setChunkOverlayEnabled(checked);
 }
 
 void MainWindow::about()
@@ -27,6 +27,9 @@
 
 #include <QtWidgets/QMainWindow>
 
+class GameClient;
+class GameEngine;
+
 namespace Ui {
 class MainWindow;
 }
@@ -38,14 +41,24 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    GameEngine* engine() const;
+    void setClient(GameClient *client);
+    void setFountainsEnabled(const bool enabled);
+
 private Q_SLOTS:
     void reset();
     void apply();
     void onRadioChanged();
+    void onWorldSizeChanged();
+    void enableFountains(bool checked);
+    void recordTrace(bool checked);
+    void profileRules(bool checked);
+    void showChunkHeatmap(bool checked);
     void about();
 
 private:
     Ui::MainWindow *ui;
+    GameClient *m_client;
 
 };
 
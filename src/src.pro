@@ -5,6 +5,7 @@ TEMPLATE = app
 TARGET   = ElementDots
 QT       += core gui
 QT       += concurrent
+QT       += network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -23,17 +24,47 @@ lessThan(QT_VERSION, 5.0) {
 INCLUDEPATH += $$PWD/../include/
 
 
+#-------------------------------------------------
+# LIBS
+#-------------------------------------------------
+# shm_open() is in librt with the older glibc
+unix:!macx {
+    LIBS += -lrt
+}
+
+
 #-------------------------------------------------
 # SOURCES
 #-------------------------------------------------
 HEADERS += \
     $$PWD/about.h \
     $$PWD/builddefs.h \
+    $$PWD/gamebatchrunner.h \
+    $$PWD/gamechunkstats.h \
+    $$PWD/gamecommandqueue.h \
+    $$PWD/gameclient.h \
+    $$PWD/gamedeltacodec.h \
     $$PWD/gameengine.h \
+    $$PWD/gameexporter.h \
+    $$PWD/gameframepublisher.h \
+    $$PWD/gameframering.h \
+    $$PWD/gamelodpyramid.h \
     $$PWD/gamematerial.h \
+    $$PWD/gamematerialrules.h \
+    $$PWD/gameplayback.h \
+    $$PWD/gameprotocol.h \
+    $$PWD/gamerecorder.h \
+    $$PWD/gamerecording.h \
     $$PWD/gamerenderer.h \
+    $$PWD/gamerulestats.h \
+    $$PWD/gameserver.h \
+    $$PWD/gamestrip.h \
+    $$PWD/gametiletuner.h \
+    $$PWD/gametracer.h \
     $$PWD/gamewidget.h \
     $$PWD/gameworld.h \
+    $$PWD/gameworldgenerator.h \
+    $$PWD/gameworldlayout.h \
     $$PWD/globals.h \
     $$PWD/perfs.h \
     $$PWD/utils.h \
@@ -41,11 +72,29 @@ HEADERS += \
     $$PWD/mainwindow.h
 
 SOURCES += \
+    $$PWD/gamebatchrunner.cpp \
+    $$PWD/gamechunkstats.cpp \
+    $$PWD/gamecommandqueue.cpp \
+    $$PWD/gameclient.cpp \
+    $$PWD/gamedeltacodec.cpp \
     $$PWD/gameengine.cpp \
+    $$PWD/gameexporter.cpp \
+    $$PWD/gameframepublisher.cpp \
+    $$PWD/gamelodpyramid.cpp \
     $$PWD/gamematerial.cpp \
+    $$PWD/gamematerialrules.cpp \
+    $$PWD/gameplayback.cpp \
+    $$PWD/gameprotocol.cpp \
+    $$PWD/gamerecorder.cpp \
     $$PWD/gamerenderer.cpp \
+    $$PWD/gamerulestats.cpp \
+    $$PWD/gameserver.cpp \
+    $$PWD/gamestrip.cpp \
+    $$PWD/gametiletuner.cpp \
+    $$PWD/gametracer.cpp \
     $$PWD/gamewidget.cpp \
     $$PWD/gameworld.cpp \
+    $$PWD/gameworldgenerator.cpp \
     $$PWD/materialradiobutton.cpp \
     $$PWD/main.cpp \
     $$PWD/mainwindow.cpp
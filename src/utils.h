@@ -28,17 +28,59 @@
 #include <QtCore/QTime>
 #include <QtCore/qmath.h>
 
-static bool seeded = false;
+/*!
+ * \brief Return true if the generator of the current thread is seeded.
+ *
+ * The generator of qrand() is per thread.
+ */
+inline bool &randomSeeded()
+{
+    static thread_local bool seeded = false;
+    return seeded;
+}
+
+/*!
+ * \brief Seed the random generator of the current thread,
+ * to replay the same sequence of values.
+ */
+inline void seedRandom(const uint seed)
+{
+    qsrand(seed);
+    randomSeeded() = true;
+}
+
+/*!
+ * \brief Return the number of random values drawn by the current thread.
+ */
+inline quint64 &randomDrawCount()
+{
+    static thread_local quint64 count = 0;
+    return count;
+}
+
+/*!
+ * \brief Return a well-mixed 32-bit hash of the \a seed and the position.
+ */
+inline quint32 positionHash(const uint seed, const int x, const int y)
+{
+    quint32 h = seed ^ ((quint32)x * 0x27d4eb2dU) ^ ((quint32)y * 0x165667b1U);
+    h ^= h >> 15;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
 
 /*!
  * \brief Return a random value between 0 and 1.
  */
 static double myrandom()
 {
-    if (!seeded) {
+    ++randomDrawCount();
+    if (!randomSeeded()) {
         /* initialize the pseudo-random number generator with a seed value. */
-        qsrand(QTime(0,0,0).secsTo(QTime::currentTime()));
-        seeded = true;
+        seedRandom(QTime(0,0,0).secsTo(QTime::currentTime()));
     }
     Q_ASSERT(RAND_MAX > 0);
     return (double)(qrand())/RAND_MAX;
@@ -0,0 +1,64 @@
+#-------------------------------------------------
+# Common settings of the auto tests
+#-------------------------------------------------
+QT       += core gui
+QT       += concurrent
+QT       += network
+QT       += testlib
+
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  += no_keyword
+CONFIG  += testcase
+
+QMAKE_CXXFLAGS += -std=c++11
+
+unix:!macx {
+    LIBS += -lrt
+}
+
+
+#-------------------------------------------------
+# INCLUDE
+#-------------------------------------------------
+INCLUDEPATH += $$PWD/../../include/
+INCLUDEPATH += $$PWD/../../src/
+
+
+#-------------------------------------------------
+# SOURCES
+#-------------------------------------------------
+# The world and the engine, without the GUI
+HEADERS += \
+    $$PWD/../../src/gamechunkstats.h \
+    $$PWD/../../src/gamecommandqueue.h \
+    $$PWD/../../src/gamedeltacodec.h \
+    $$PWD/../../src/gameengine.h \
+    $$PWD/../../src/gameframepublisher.h \
+    $$PWD/../../src/gameframering.h \
+    $$PWD/../../src/gamematerial.h \
+    $$PWD/../../src/gamematerialrules.h \
+    $$PWD/../../src/gameprotocol.h \
+    $$PWD/../../src/gamerecorder.h \
+    $$PWD/../../src/gamerecording.h \
+    $$PWD/../../src/gamerulestats.h \
+    $$PWD/../../src/gametracer.h \
+    $$PWD/../../src/gameworld.h \
+    $$PWD/../../src/gameworldgenerator.h \
+    $$PWD/../../src/gameworldlayout.h \
+    $$PWD/../../src/utils.h
+
+SOURCES += \
+    $$PWD/../../src/gamechunkstats.cpp \
+    $$PWD/../../src/gamecommandqueue.cpp \
+    $$PWD/../../src/gamedeltacodec.cpp \
+    $$PWD/../../src/gameengine.cpp \
+    $$PWD/../../src/gameframepublisher.cpp \
+    $$PWD/../../src/gamematerial.cpp \
+    $$PWD/../../src/gamematerialrules.cpp \
+    $$PWD/../../src/gameprotocol.cpp \
+    $$PWD/../../src/gamerecorder.cpp \
+    $$PWD/../../src/gamerulestats.cpp \
+    $$PWD/../../src/gametracer.cpp \
+    $$PWD/../../src/gameworld.cpp \
+    $$PWD/../../src/gameworldgenerator.cpp
@@ -2,4 +2,8 @@ TEMPLATE = subdirs
 CONFIG  += ordered
 
 #SUBDIRS += $$PWD/gamewidget
+SUBDIRS += $$PWD/gamerecorder
+SUBDIRS += $$PWD/gameserver
+SUBDIRS += $$PWD/gamestrip
+SUBDIRS += $$PWD/gameworld
 
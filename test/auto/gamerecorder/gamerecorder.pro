@@ -0,0 +1,14 @@
+#-------------------------------------------------
+# Test of the recording and its playback
+#-------------------------------------------------
+TEMPLATE = app
+TARGET   = tst_gamerecorder
+
+include($$PWD/../auto.pri)
+
+HEADERS += \
+    $$PWD/../../../src/gameplayback.h
+
+SOURCES += \
+    $$PWD/../../../src/gameplayback.cpp \
+    $$PWD/tst_gamerecorder.cpp
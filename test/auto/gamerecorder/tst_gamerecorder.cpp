@@ -0,0 +1,170 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gameengine.h"
+#include "gameplayback.h"
+#include "gamerecording.h"
+#include "gameworld.h"
+#include "gameworldgenerator.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+#include <cstring>
+
+#define C_STEPS              60
+#define C_RESIZE_STEP        30
+#define C_KEYFRAME_INTERVAL   4
+#define C_SEED               42
+
+/* Compare the worlds cell by cell, color variation included */
+static bool isSameWorld(const GameWorld *a, const GameWorld *b)
+{
+    if (a->width() != b->width() || a->height() != b->height()) {
+        return false;
+    }
+    for (int y = 0; y < a->height(); ++y) {
+        if (std::memcmp(a->constScanLine(y), b->constScanLine(y), a->width()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class tst_GameRecorder : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void seek();
+    void seekWithoutTrailer();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_fileName;
+    QList<QSharedPointer<GameWorld> > m_worlds; /* the live world of each tick */
+    int m_keyframeCount;
+    quint64 m_lastTick;
+
+    void checkSeek(GamePlayback &playback, const quint64 tick);
+};
+
+/*
+ * Record the steps of a live engine, with a resize in the middle,
+ * and keep a copy of the world of each tick.
+ */
+void tst_GameRecorder::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_fileName = m_dir.filePath("session.eldr");
+
+    GameEngine engine;
+    engine.setRunning(false);
+    engine.setFountainsEnabled(false);
+    engine.setSize(64, 48);
+    GameTerrainGenerator generator;
+    engine.generate(&generator, C_SEED);
+
+    QString errorString;
+    QVERIFY2(engine.startRecording(m_fileName, C_KEYFRAME_INTERVAL, &errorString),
+             qPrintable(errorString));
+    QCOMPARE(engine.tick(), (quint64)0);
+    m_worlds.clear();
+    for (int i = 0; i <= C_STEPS; ++i) {
+        if (i > 0) {
+            if (i == C_RESIZE_STEP) {
+                engine.setSize(80, 40);
+                engine.generate(&generator, C_SEED + 1);
+            }
+            engine.step();
+        }
+        QCOMPARE(engine.tick(), (quint64)i);
+        QSharedPointer<GameWorld> world(new GameWorld());
+        engine.world()->copyTo(world.data());
+        m_worlds << world;
+    }
+    engine.stopRecording();
+
+    GamePlayback playback(m_fileName);
+    QVERIFY2(playback.open(), qPrintable(playback.errorString()));
+    QCOMPARE(playback.keyframeInterval(), C_KEYFRAME_INTERVAL);
+    QVERIFY(playback.keyframeCount() > 1);
+    m_keyframeCount = playback.keyframeCount();
+    m_lastTick = playback.lastTick();
+}
+
+void tst_GameRecorder::checkSeek(GamePlayback &playback, const quint64 tick)
+{
+    GameWorld world;
+    QVERIFY2(playback.seek(tick, &world), qPrintable(playback.errorString()));
+    QVERIFY2(isSameWorld(&world, m_worlds.at((int)tick).data()),
+             qPrintable(QString("tick %0").arg(tick)));
+}
+
+/*
+ * seek() gives the live world of each tick, on a keyframe or between two,
+ * before and after the resize, forward and backward.
+ */
+void tst_GameRecorder::seek()
+{
+    GamePlayback playback(m_fileName);
+    QVERIFY2(playback.open(), qPrintable(playback.errorString()));
+    for (int tick = 0; tick <= C_STEPS; ++tick) {
+        checkSeek(playback, tick);
+        if (QTest::currentTestFailed()) return;
+    }
+    for (int tick = C_STEPS; tick >= 0; --tick) {
+        checkSeek(playback, tick);
+        if (QTest::currentTestFailed()) return;
+    }
+}
+
+/*
+ * Without its trailer, e.g. if the recorder was killed, the index
+ * is rebuilt from the records.
+ */
+void tst_GameRecorder::seekWithoutTrailer()
+{
+    const QString fileName = m_dir.filePath("truncated.eldr");
+    QVERIFY(QFile::copy(m_fileName, fileName));
+    QFile file(fileName);
+    QVERIFY(file.resize(file.size() - C_RECORDING_TRAILER_SIZE));
+
+    GamePlayback playback(fileName);
+    QVERIFY2(playback.open(), qPrintable(playback.errorString()));
+    QCOMPARE(playback.keyframeCount(), m_keyframeCount);
+    QCOMPARE(playback.lastTick(), m_lastTick);
+    for (int tick = 0; tick <= C_STEPS; ++tick) {
+        checkSeek(playback, tick);
+        if (QTest::currentTestFailed()) return;
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_GameRecorder)
+
+#include "tst_gamerecorder.moc"
@@ -0,0 +1,16 @@
+#-------------------------------------------------
+# Test of the shared world, on a local socket
+#-------------------------------------------------
+TEMPLATE = app
+TARGET   = tst_gameserver
+
+include($$PWD/../auto.pri)
+
+HEADERS += \
+    $$PWD/../../../src/gameclient.h \
+    $$PWD/../../../src/gameserver.h
+
+SOURCES += \
+    $$PWD/../../../src/gameclient.cpp \
+    $$PWD/../../../src/gameserver.cpp \
+    $$PWD/tst_gameserver.cpp
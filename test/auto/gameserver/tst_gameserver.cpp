@@ -0,0 +1,146 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gameclient.h"
+#include "gamedeltacodec.h"
+#include "gameengine.h"
+#include "gameserver.h"
+#include "gameworld.h"
+#include "gameworldgenerator.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtTest/QtTest>
+
+#include <cstring>
+
+#define C_WIDTH      96
+#define C_HEIGHT     64
+#define C_STEPS      50
+#define C_SEED       42
+#define C_TIMEOUT    5000 // ms
+
+/* Compare the worlds cell by cell, color variation included */
+static bool isSameWorld(const GameWorld *a, const GameWorld *b)
+{
+    if (a->width() != b->width() || a->height() != b->height()) {
+        return false;
+    }
+    for (int y = 0; y < a->height(); ++y) {
+        if (std::memcmp(a->constScanLine(y), b->constScanLine(y), a->width()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class tst_GameServer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void mirrorOnLoopback();
+    void encodeManyRects();
+};
+
+/*
+ * The client's mirror matches the server's world after the keyframe,
+ * and after each delta.
+ */
+void tst_GameServer::mirrorOnLoopback()
+{
+    const QString name = QString("tst_gameserver-%0").arg(QCoreApplication::applicationPid());
+
+    GameEngine engine;
+    engine.setRunning(false);
+    engine.setSize(C_WIDTH, C_HEIGHT);
+    GameTerrainGenerator generator;
+    engine.generate(&generator, C_SEED);
+
+    GameServer server(&engine);
+    server.setKeyframeInterval(C_STEPS * 10); // only the first one
+    QVERIFY2(server.listen(name), qPrintable(server.errorString()));
+
+    GameEngine mirror;
+    GameClient client(&mirror);
+    client.connectToServer(name);
+    QTRY_COMPARE_WITH_TIMEOUT(server.clientCount(), 1, C_TIMEOUT);
+
+    /* The keyframe goes with the next step */
+    engine.step();
+    QTRY_VERIFY_WITH_TIMEOUT(client.isSynchronized(), C_TIMEOUT);
+    QTRY_COMPARE_WITH_TIMEOUT(client.tick(), engine.tick(), C_TIMEOUT);
+    QCOMPARE(mirror.width(), C_WIDTH);
+    QCOMPARE(mirror.height(), C_HEIGHT);
+    QVERIFY(isSameWorld(mirror.world().data(), engine.world().data()));
+
+    int deltas = 0;
+    for (int i = 0; i < C_STEPS; ++i) {
+        engine.step();
+        if (engine.dirtyRects().isEmpty()) {
+            continue; // nothing sent
+        }
+        ++deltas;
+        QTRY_COMPARE_WITH_TIMEOUT(client.tick(), engine.tick(), C_TIMEOUT);
+        QVERIFY(client.isSynchronized());
+        QVERIFY(isSameWorld(mirror.world().data(), engine.world().data()));
+    }
+    QVERIFY(deltas > 0);
+}
+
+/*
+ * Past 1024 rectangles, the delta is a single rectangle,
+ * and it still gives the same world.
+ */
+void tst_GameServer::encodeManyRects()
+{
+    GameWorld world;
+    world.setSize(C_WIDTH, C_HEIGHT);
+    GameTerrainGenerator generator;
+    world.generate(&generator, C_SEED);
+
+    GameWorld copy;
+    world.copyTo(&copy);
+
+    /* Scattered dots, one rectangle each */
+    QVector<QRect> rects;
+    for (int y = 0; y < C_HEIGHT; ++y) {
+        for (int x = (y % 3); x < C_WIDTH; x += 3) {
+            world.setDot(x, y, (world.dot(x, y) == Material::Sand) ? Material::Water : Material::Sand);
+            rects << QRect(x, y, 1, 1);
+        }
+    }
+    QVERIFY(rects.count() > 1024);
+
+    const QByteArray data = GameDeltaCodec::encode(&world, rects);
+    QVERIFY(data.size() >= 2);
+    QCOMPARE((int)(uchar)data.at(0) | ((int)(uchar)data.at(1) << 8), 1);
+
+    QVERIFY(GameDeltaCodec::decode(data, &copy));
+    QVERIFY(isSameWorld(&copy, &world));
+}
+
+QTEST_GUILESS_MAIN(tst_GameServer)
+
+#include "tst_gameserver.moc"
@@ -0,0 +1,14 @@
+#-------------------------------------------------
+# Test of the strips of a distributed simulation
+#-------------------------------------------------
+TEMPLATE = app
+TARGET   = tst_gamestrip
+
+include($$PWD/../auto.pri)
+
+HEADERS += \
+    $$PWD/../../../src/gamestrip.h
+
+SOURCES += \
+    $$PWD/../../../src/gamestrip.cpp \
+    $$PWD/tst_gamestrip.cpp
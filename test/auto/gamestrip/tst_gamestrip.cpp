@@ -0,0 +1,225 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gameengine.h"
+#include "gamematerial.h"
+#include "gamestrip.h"
+#include "gameworld.h"
+#include "utils.h"
+
+#include <QtConcurrent/QtConcurrent>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QThreadPool>
+#include <QtTest/QtTest>
+
+#define C_WIDTH   64
+#define C_HEIGHT  128 /* the strips are at least as high as the halo */
+#define C_STRIPS  4
+#define C_STEPS   300
+#define C_BORDER  3   /* the liquids move up to 3 dots aside */
+
+#define C_FIRE_HEIGHT  96
+#define C_FIRE_STRIPS  2
+#define C_FIRE_STEPS   2
+#define C_FIRE_ROW     (C_FIRE_HEIGHT / C_FIRE_STRIPS) /* first row of the lower strip */
+#define C_OLD_HALO     20
+
+/*
+ * The materials that only move, by swapping dots,
+ * in a box of Rock so that no dot falls out of the world.
+ */
+static Material initialDot(const int x, const int y)
+{
+    if (x < C_BORDER || x >= C_WIDTH - C_BORDER || y == C_HEIGHT - 1) {
+        return Material::Rock;
+    }
+    switch (positionHash(1, x, y) % 3) {
+    case 0:  return Material::Air;
+    case 1:  return Material::Sand;
+    default: return Material::Water;
+    }
+}
+
+static QVector<int> initialCounts()
+{
+    QVector<int> counts(materialCount(), 0);
+    for (int y = 0; y < C_HEIGHT; ++y) {
+        for (int x = 0; x < C_WIDTH; ++x) {
+            ++counts[(int)initialDot(x, y)];
+        }
+    }
+    return counts;
+}
+
+/* Run the strip, and return the count of each material of its rows */
+static QVector<int> runStrip(const QString &session, const int index)
+{
+    GameStrip strip(session, index, C_STRIPS, C_WIDTH, C_HEIGHT);
+    if (!strip.open()) {
+        qWarning("%s", qPrintable(strip.errorString()));
+        return QVector<int>();
+    }
+    seedRandom(index + 1);
+
+    GameWorld *world = strip.engine()->world().data();
+    for (int y = 0; y < world->height(); ++y) {
+        for (int x = 0; x < C_WIDTH; ++x) {
+            world->setDot(x, y, initialDot(x, strip.top() + y));
+        }
+    }
+    for (int i = 0; i < C_STEPS; ++i) {
+        if (!strip.step()) {
+            qWarning("%s", qPrintable(strip.errorString()));
+            return QVector<int>();
+        }
+    }
+
+    QVector<int> counts(materialCount(), 0);
+    for (int y = strip.firstRow(); y <= strip.lastRow(); ++y) {
+        for (int x = 0; x < C_WIDTH; ++x) {
+            ++counts[(int)world->dot(x, y - strip.top())];
+        }
+    }
+    return counts;
+}
+
+/*
+ * A layer of burning Oil on the first rows of the lower strip.
+ */
+static Material burningDot(const int x, const int y)
+{
+    if (y == C_FIRE_HEIGHT - 1) {
+        return Material::Rock;
+    }
+    if (x > 0 && x < C_WIDTH - 1) {
+        if (y == C_FIRE_ROW) {
+            return Material::Fire;
+        }
+        if (y == C_FIRE_ROW + 1 || y == C_FIRE_ROW + 2) {
+            return Material::Oil;
+        }
+    }
+    return Material::Air;
+}
+
+/* Run the strip, and return the highest row of its Fire dots during the steps */
+static int runBurningStrip(const QString &session, const int index)
+{
+    GameStrip strip(session, index, C_FIRE_STRIPS, C_WIDTH, C_FIRE_HEIGHT);
+    if (!strip.open()) {
+        qWarning("%s", qPrintable(strip.errorString()));
+        return -1;
+    }
+    seedRandom(index + 1);
+
+    GameWorld *world = strip.engine()->world().data();
+    for (int y = 0; y < world->height(); ++y) {
+        for (int x = 0; x < C_WIDTH; ++x) {
+            world->setDot(x, y, burningDot(x, strip.top() + y));
+        }
+    }
+    int highest = C_FIRE_HEIGHT;
+    for (int i = 0; i < C_FIRE_STEPS; ++i) {
+        if (!strip.step()) {
+            qWarning("%s", qPrintable(strip.errorString()));
+            return -1;
+        }
+        for (int y = strip.firstRow(); y <= strip.lastRow() && y < highest; ++y) {
+            for (int x = 0; x < C_WIDTH; ++x) {
+                if (world->dot(x, y - strip.top()) == Material::Fire) {
+                    highest = y;
+                    break;
+                }
+            }
+        }
+    }
+    return highest;
+}
+
+class tst_GameStrip : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void conserveMaterials();
+    void keepFirePlume();
+};
+
+/*
+ * The dots that fall or swap across the boundaries of the strips
+ * are neither lost nor duplicated.
+ */
+void tst_GameStrip::conserveMaterials()
+{
+    const QString session = QString("tst_gamestrip-%0").arg(QCoreApplication::applicationPid());
+
+    /* The strips run in lockstep: one thread each */
+    QThreadPool pool;
+    pool.setMaxThreadCount(C_STRIPS);
+    QList<QFuture<QVector<int> > > futures;
+    for (int index = 0; index < C_STRIPS; ++index) {
+        futures << QtConcurrent::run(&pool, runStrip, session, index);
+    }
+
+    QVector<int> counts(materialCount(), 0);
+    foreach (QFuture<QVector<int> > future, futures) {
+        const QVector<int> stripCounts = future.result();
+        QCOMPARE(stripCounts.count(), materialCount());
+        for (int i = 0; i < counts.count(); ++i) {
+            counts[i] += stripCounts.at(i);
+        }
+    }
+
+    const QVector<int> expected = initialCounts();
+    for (int i = 0; i < expected.count(); ++i) {
+        QCOMPARE(counts.at(i), expected.at(i));
+    }
+}
+
+/*
+ * The Oil burning at the top of the lower strip throws flames
+ * up to 30 rows above, into the rows of the upper strip.
+ * The other flames reach 10 rows above, and climb a few rows per step.
+ */
+void tst_GameStrip::keepFirePlume()
+{
+    const QString session = QString("tst_gamestrip-fire-%0").arg(QCoreApplication::applicationPid());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(C_FIRE_STRIPS);
+    QList<QFuture<int> > futures;
+    for (int index = 0; index < C_FIRE_STRIPS; ++index) {
+        futures << QtConcurrent::run(&pool, runBurningStrip, session, index);
+    }
+    foreach (QFuture<int> future, futures) {
+        QVERIFY(future.result() >= 0);
+    }
+
+    /* The upper strip received the flames written far above the boundary */
+    QVERIFY(futures.first().result() < C_FIRE_ROW - C_OLD_HALO);
+}
+
+QTEST_GUILESS_MAIN(tst_GameStrip)
+
+#include "tst_gamestrip.moc"
@@ -0,0 +1,10 @@
+#-------------------------------------------------
+# Test of the world and its region queries
+#-------------------------------------------------
+TEMPLATE = app
+TARGET   = tst_gameworld
+
+include($$PWD/../auto.pri)
+
+SOURCES += \
+    $$PWD/tst_gameworld.cpp
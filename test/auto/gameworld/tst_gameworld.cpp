@@ -0,0 +1,135 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gamematerial.h"
+#include "gameworld.h"
+
+#include <QtTest/QtTest>
+
+#define C_ITERATIONS  2000
+#define C_MAX_WRITES  50
+
+/* Count the dots by reading them, one by one */
+static int countDots(const GameWorld &world, const Material material, const QRect &rect)
+{
+    const QRect r = rect.intersected(QRect(0, 0, world.width(), world.height()));
+    int count = 0;
+    for (int y = r.top(); y <= r.bottom(); ++y) {
+        for (int x = r.left(); x <= r.right(); ++x) {
+            if (world.dot(x, y) == material) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+/* A rect that can cross, or be out of, the edges of the world */
+static QRect randomRect(const GameWorld &world)
+{
+    return QRect(qrand() % (world.width() + 10) - 5, qrand() % (world.height() + 10) - 5,
+                 qrand() % (world.width() + 10), qrand() % (world.height() + 10));
+}
+
+static void writeRandomly(GameWorld &world)
+{
+    const int writes = qrand() % C_MAX_WRITES;
+    for (int i = 0; i < writes; ++i) {
+        world.setDot(qrand() % world.width(), qrand() % world.height(),
+                     (Material)(qrand() % materialCount()));
+    }
+}
+
+class tst_GameWorld : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void regionPopulation_data();
+    void regionPopulation();
+    void regionPopulationOfCopy();
+};
+
+void tst_GameWorld::regionPopulation_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+
+    /* Whole chunks, partial chunks, and a single chunk */
+    QTest::newRow("160x160") << 160 << 160;
+    QTest::newRow("100x37") << 100 << 37;
+    QTest::newRow("16x16") << 16 << 16;
+    QTest::newRow("33x70") << 33 << 70;
+    QTest::newRow("256x64") << 256 << 64;
+}
+
+/*
+ * The index gives the same count as reading the dots,
+ * between the writes and after clear().
+ */
+void tst_GameWorld::regionPopulation()
+{
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    qsrand(1);
+    GameWorld world;
+    world.setSize(width, height);
+    for (int i = 0; i < C_ITERATIONS; ++i) {
+        writeRandomly(world);
+        const QRect rect = randomRect(world);
+        const Material material = (Material)(qrand() % materialCount());
+        QCOMPARE(world.population(material, rect), countDots(world, material, rect));
+        if (i == C_ITERATIONS / 2) {
+            world.clear();
+        }
+    }
+}
+
+/*
+ * A copy counts the populations of its chunks at its first query,
+ * and the copied world isn't affected.
+ */
+void tst_GameWorld::regionPopulationOfCopy()
+{
+    qsrand(2);
+    GameWorld world;
+    world.setSize(100, 37);
+    GameWorld copy;
+    for (int i = 0; i < C_ITERATIONS; ++i) {
+        writeRandomly(world);
+        if (i % 100 == 0) {
+            world.copyTo(&copy);
+        }
+        writeRandomly(copy);
+        const QRect rect = randomRect(world);
+        const Material material = (Material)(qrand() % materialCount());
+        QCOMPARE(world.population(material, rect), countDots(world, material, rect));
+        QCOMPARE(copy.population(material, rect), countDots(copy, material, rect));
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_GameWorld)
+
+#include "tst_gameworld.moc"
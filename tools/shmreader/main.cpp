@@ -0,0 +1,240 @@
+/* - ElementDots - Copyright (C) 2017 Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Reference reader of the frames published by ElementDots --publish <name>.
+ *
+ * It runs without display, and either prints one line per frame,
+ * or writes the frames as raw RGB24 to the standard output:
+ *
+ *      $ ./shmreader elementdots
+ *      $ ./shmreader --raw elementdots | ffplay -f rawvideo -pixel_format rgb24 \
+ *                                                -video_size 160x160 -
+ *
+ * See gameframering.h for the layout of the shared memory.
+ */
+
+#include "gameframering.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+
+#include <atomic>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define C_BACKGROUND_COLOR 0xffffffff // Air
+#define C_OPEN_RETRY_IN_MILLISECOND 100
+#define C_POLL_IN_MILLISECOND         1
+
+/*
+ * Map the shared memory, read-only.
+ * Return null if the publisher hasn't created it yet.
+ */
+static GameFrameRingHeader* openRing(const QByteArray &name, size_t *size)
+{
+    const int fd = shm_open(name.constData(), O_RDONLY, 0);
+    if (fd < 0) {
+        return Q_NULLPTR;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < frameRingHeaderSize()) {
+        ::close(fd);
+        return Q_NULLPTR;
+    }
+    void *data = mmap(Q_NULLPTR, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return Q_NULLPTR;
+    }
+    GameFrameRingHeader *header = (GameFrameRingHeader*)data;
+    if (header->magic.loadAcquire() != C_FRAME_RING_MAGIC
+            || header->version != C_FRAME_RING_VERSION) {
+        munmap(data, st.st_size);
+        return Q_NULLPTR;
+    }
+    *size = st.st_size;
+    return header;
+}
+
+/*
+ * The colors are 0xAARRGGBB, see GameFrameRingHeader.
+ * Unpack them here, without QtGui.
+ */
+static inline uchar alphaOf(quint32 color) { return (color >> 24) & 0xff; }
+static inline uchar redOf(quint32 color)   { return (color >> 16) & 0xff; }
+static inline uchar greenOf(quint32 color) { return (color >> 8) & 0xff; }
+static inline uchar blueOf(quint32 color)  { return color & 0xff; }
+
+/*
+ * Convert the cells into RGB24, without the row padding.
+ */
+static void convertFrame(const GameFrameRingHeader *header, const uchar *cells, QByteArray &rgb)
+{
+    rgb.resize(3 * header->width * header->height);
+    uchar *out = (uchar*)rgb.data();
+    for (quint32 y = 0; y < header->height; ++y) {
+        const uchar *line = cells + y * header->stride;
+        for (quint32 x = 0; x < header->width; ++x) {
+            quint32 color = header->colors[line[x]];
+            if (alphaOf(color) == 0) {
+                color = C_BACKGROUND_COLOR;
+            }
+            *out++ = redOf(color);
+            *out++ = greenOf(color);
+            *out++ = blueOf(color);
+        }
+    }
+}
+
+/*
+ * Count the visible dots, in place.
+ */
+static int countDots(const GameFrameRingHeader *header, const uchar *cells)
+{
+    int count = 0;
+    for (quint32 y = 0; y < header->height; ++y) {
+        const uchar *line = cells + y * header->stride;
+        for (quint32 x = 0; x < header->width; ++x) {
+            if (alphaOf(header->colors[line[x]]) != 0) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Reads the frames published by ElementDots --publish.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("name", "Name of the shared memory.");
+    parser.addOptions({
+        {"raw", "Write the frames as raw RGB24 to the standard output."},
+        {"count", "Stop after the given number of frames (0 for never).", "count", "0"}
+    });
+    parser.process(app);
+
+    if (parser.positionalArguments().count() != 1) {
+        parser.showHelp(1);
+    }
+    QString name = parser.positionalArguments().first();
+    if (!name.startsWith(QLatin1Char('/'))) {
+        name.prepend(QLatin1Char('/'));
+    }
+    const QByteArray shmName = QFile::encodeName(name);
+    const quint64 count = parser.value("count").toULongLong();
+    const bool raw = parser.isSet("raw");
+
+    QTextStream err(stderr);
+    QFile out;
+    if (raw && !out.open(stdout, QIODevice::WriteOnly)) {
+        err << out.errorString() << endl;
+        return 1;
+    }
+
+    GameFrameRingHeader *header = Q_NULLPTR;
+    size_t size = 0;
+    quint64 last = 0;
+    quint64 frames = 0;
+    quint64 dropped = 0;
+    quint64 torn = 0;
+    QByteArray rgb;
+
+    while (count == 0 || frames < count) {
+        if (!header) {
+            header = openRing(shmName, &size);
+            if (!header) {
+                QThread::msleep(C_OPEN_RETRY_IN_MILLISECOND);
+            }
+            continue;
+        }
+        /* The size of the world changed: map the new segment */
+        if (header->closed.loadAcquire()) {
+            munmap(header, size);
+            header = Q_NULLPTR;
+            continue;
+        }
+        const quint64 head = header->head.loadAcquire();
+        if (head == 0 || head == last) {
+            QThread::msleep(C_POLL_IN_MILLISECOND);
+            continue;
+        }
+        GameFrameRingSlot *slot = frameRingSlot(header, head);
+        if (slot->sequence.loadAcquire() != head) {
+            continue; // overwritten already
+        }
+
+        /* Use the cells in place */
+        const quint64 tick = slot->tick;
+        const uchar *cells = frameRingCells(slot);
+        int dots = 0;
+        if (raw) {
+            convertFrame(header, cells, rgb);
+        } else {
+            dots = countDots(header, cells);
+        }
+
+        /* Check that the publisher didn't start to overwrite the slot meanwhile */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load() != head) {
+            ++torn;
+            continue;
+        }
+        if (last != 0 && head > last + 1) {
+            dropped += head - last - 1;
+        }
+        last = head;
+        ++frames;
+
+        if (raw) {
+            if (out.write(rgb) != rgb.size()) {
+                err << out.errorString() << endl;
+                return 1;
+            }
+            out.flush();
+        } else {
+            err << QString("frame %0 tick %1 size %2x%3 dots %4")
+                   .arg(head).arg(tick).arg(header->width).arg(header->height).arg(dots)
+                << endl;
+        }
+    }
+
+    err << QString("%0 frames read, %1 dropped, %2 torn").arg(frames).arg(dropped).arg(torn)
+        << endl;
+    if (header) {
+        munmap(header, size);
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+# Reference reader of the shared-memory frames
+#-------------------------------------------------
+TEMPLATE = app
+TARGET   = shmreader
+QT       += core
+QT       -= gui
+
+CONFIG  += console
+CONFIG  -= app_bundle
+CONFIG  += no_keyword
+
+QMAKE_CXXFLAGS += -std=c++11
+
+unix:!macx {
+    LIBS += -lrt
+}
+
+#-------------------------------------------------
+# INCLUDE
+#-------------------------------------------------
+INCLUDEPATH += $$PWD/../../src/
+
+
+#-------------------------------------------------
+# SOURCES
+#-------------------------------------------------
+HEADERS += \
+    $$PWD/../../src/gameframering.h
+
+SOURCES += \
+    $$PWD/main.cpp
@@ -0,0 +1,4 @@
+TEMPLATE = subdirs
+CONFIG  += ordered
+
+SUBDIRS += $$PWD/shmreader/shmreader.pro